@@ -21,10 +21,35 @@
 #include <cstring>
 #include <condition_variable>
 #include <queue>
+#include <deque>
+#include <memory>
 #include <iomanip>
 #include <cmath>
-
-// Forward declaration for AnifetchArgs for get_file_stats_string_for_hashing
+#include <cstdint>
+#include <array>
+#include <limits>
+#include <string_view>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/syscall.h>
+#include <charconv>
+#include <cctype>
+#include <unordered_map>
+#include <set>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+// Forward declaration for AnifetchArgs
 struct AnifetchArgs;
 extern AnifetchArgs g_args; // Declare g_args as extern
 
@@ -42,26 +67,49 @@ struct AnifetchArgs {
     bool sound_flag_given = false;
     std::string sound_saved_path;   // Path to cached sound file
     bool force_render = false;
+    bool full_redraw = false;       // Playback: redraw whole frames instead of applying cached deltas
+    int progressive_frames = 0;     // Playback: on a cache miss, start once this many frames are ready (0 = off)
+    int threads = 0;                // Worker threads for rendering (0 = one per hardware thread)
+    bool render_only = false;       // Build or validate the cache, then exit without playing
+    std::string memory_budget = "8M"; // Playback: decoded frame text kept in memory (suffixes K, M, G)
+    size_t memory_budget_bytes = 0; // memory_budget, parsed
+    bool retain_frames = false;     // Playback: keep pack pages of played frames mapped for later loops
+    double info_ttl = 300.0;        // Seconds a cached fastfetch output is shown without running fastfetch
+    double info_refresh = 0.0;      // Playback: seconds between background fastfetch runs (0 = never)
+    bool stats = false;             // Print a timing summary on exit
+    std::string stats_json_path;    // Write timings and histograms as JSON on exit
+    std::string sync_update = "auto"; // Playback: DEC 2026 synchronized updates ("auto", "on", "off")
     std::string chafa_arguments = "--symbols ascii --fg-only";
+    int chafa_batch = 16;           // Most frames one Chafa process converts (1 = a process per frame)
     std::string chroma_arg;         // Chroma key color
     bool chroma_flag_given = false;
+    std::string decode_mode = "stream"; // "stream" (rawvideo over a pipe) or "png" (PNG files per frame)
+    std::string renderer = "auto";      // "auto", "native" or "chafa"; resolved to native/chafa after parsing
+    std::string color_depth = "truecolor"; // "truecolor", "256", "16" or "auto"; auto is resolved after parsing
+    bool decode_cache = false;      // Stream mode: decode through the shared decoded-frame tier
+    std::vector<int> pyramid_widths; // Frame widths rendered for terminal resizes, --horizontal included (empty = off)
+    bool daemon = false;            // Stay resident and prepare animations for --connect clients
+    bool connect = false;           // Have a --daemon prepare the animation, or prepare it here if none answers
+    std::string socket_path;        // The daemon's Unix socket; resolved after parsing
     int num_frames = 0;             // Total ASCII frames generated/cached
-
-    // Helper for to_cache_map, defined after AnifetchArgs
-    std::string get_file_stats_string_for_hashing_member(const std::string& filepath) const;
-
+    std::string video_identity;     // Sampled content hash of the input video (compute_video_identity)
 
     // Data for cache.txt
     std::map<std::string, std::string> to_cache_map(double current_video_duration) const {
         std::map<std::string, std::string> m;
         m["filename_basename"] = std::filesystem::path(filename).filename().string();
-        m["video_file_identity"] = get_file_stats_string_for_hashing_member(filename); // Store for inspection
+        m["video_file_identity"] = video_identity; // Store for inspection
         m["width"] = std::to_string(width);
         m["height_arg"] = std::to_string(height_arg);
         m["framerate"] = std::to_string(framerate);
         m["chafa_arguments"] = chafa_arguments;
         m["chroma_arg"] = chroma_arg;
         m["sound_arg"] = sound_arg;
+        m["decode_mode"] = decode_mode;
+        m["renderer"] = renderer;
+        if (color_depth != "truecolor") m["color_depth"] = color_depth;
+        if (decode_cache) m["decode_cache_width"] = std::to_string(decode_cache_width());
+        if (!pyramid_widths.empty()) m["pyramid"] = pyramid_list();
         m["original_full_filename"] = filename;
         m["playback_rate"] = std::to_string(playback_rate);
         m["actual_chafa_height"] = std::to_string(actual_chafa_height);
@@ -71,17 +119,45 @@ struct AnifetchArgs {
         return m;
     }
 
-    // Data for cache hash generation and input comparison
-    std::map<std::string, std::string> to_input_map() const {
+    // Inputs that decide the rendered frames; their hash names the shared frame pack
+    std::map<std::string, std::string> to_frame_input_map() const {
         std::map<std::string, std::string> m;
-        m["filename_basename"] = std::filesystem::path(filename).filename().string();
-        m["video_file_identity"] = get_file_stats_string_for_hashing_member(filename);
+        m["video_file_identity"] = video_identity;
         m["width"] = std::to_string(width);
         m["height_arg"] = std::to_string(height_arg);
         m["framerate"] = std::to_string(framerate);
         m["chafa_arguments"] = chafa_arguments;
         m["chroma_arg"] = chroma_arg;
+        m["decode_mode"] = decode_mode;
+        m["renderer"] = renderer;
+        if (color_depth != "truecolor") m["color_depth"] = color_depth;
+        if (decode_cache) m["decode_cache_width"] = std::to_string(decode_cache_width()); // Frames come from the tier's pixels
+        return m;
+    }
+
+    // Widest decoded-frame tier this width reads from: the power of two covering 8 pixels per cell,
+    // at least 512. Every width in a bucket shares one tier, and all levels of a pyramid use the
+    // bucket of the widest, so one decode serves them all.
+    int decode_cache_width() const {
+        int widest = width;
+        for (int level_width : pyramid_widths) widest = std::max(widest, level_width);
+        int bucket = 512;
+        while (bucket < widest * 8 && bucket < (1 << 20)) bucket *= 2;
+        return bucket;
+    }
+
+    std::string pyramid_list() const {
+        std::string list;
+        for (int level_width : pyramid_widths) list += (list.empty() ? "" : ",") + std::to_string(level_width);
+        return list;
+    }
+
+    // Data for cache hash generation and input comparison
+    std::map<std::string, std::string> to_input_map() const {
+        std::map<std::string, std::string> m = to_frame_input_map();
+        m["filename_basename"] = std::filesystem::path(filename).filename().string();
         m["sound_arg"] = sound_arg;
+        if (!pyramid_widths.empty()) m["pyramid"] = pyramid_list();
         return m;
     }
 };
@@ -91,24 +167,270 @@ AnifetchArgs g_args; // Global application arguments
 // Cache and Asset Paths
 std::filesystem::path g_video_specific_cache_root;    // e.g., [project_root]/.cache/myvideo.mp4/
 std::filesystem::path g_current_args_cache_dir;       // e.g., [project_root]/.cache/myvideo.mp4/hash123/
-std::filesystem::path g_processed_png_path;           // Final PNGs from FFmpeg (e.g., .../hash123/final_pngs/)
+std::filesystem::path g_render_staging_path;          // Resumable state of a frame pack build (e.g., .cache/frames/<key>.render/)
+std::filesystem::path g_processed_png_path;           // Final PNGs from FFmpeg (e.g., .../<key>.render/final_pngs/)
 std::filesystem::path g_temp_png_segments_path;       // Temp dir for FFmpeg segment outputs
-std::filesystem::path g_processed_ascii_path;         // Final ASCII art files (e.g., .../hash123/ascii_art/)
+std::filesystem::path g_batch_png_path;               // Stream mode: PNGs of frames batched into one Chafa run
+std::filesystem::path g_processed_ascii_path;         // Per-frame ASCII files while rendering (e.g., .../<key>.render/ascii_art/)
+std::filesystem::path g_frame_pack_path;              // Packed ASCII frames (e.g., .cache/frames/<key>.pack)
 std::filesystem::path g_current_cache_metadata_file;  // e.g., .../hash123/cache.txt
 
 // Threading & Synchronization Primitives
 std::mutex g_verbose_mutex; // For thread-safe verbose output
 std::mutex g_cerr_mutex;    // For thread-safe std::cerr output
 
-std::queue<std::pair<std::filesystem::path, int>> g_ascii_conversion_queue; // PNGs waiting for ASCII conversion
-std::mutex g_conversion_queue_mutex;
-std::condition_variable g_conversion_queue_cv;
-
 std::atomic<bool> g_ffmpeg_extraction_done(false);  // True when all FFmpeg video segments are processed
-std::atomic<bool> g_png_processing_done(false);     // True when PNG preparation/dispatching is complete
 std::atomic<int> g_pngs_ready_for_ascii(0);         // Count of PNGs successfully prepared and queued
 std::atomic<int> g_ascii_frames_completed(0);       // Count of ASCII files successfully converted and saved
 std::atomic<bool> g_pipeline_error_occurred(false); // Global flag for critical pipeline errors
+std::atomic<bool> g_asset_build_running(false);     // A cache build has worker threads running
+
+// Work-stealing task pool shared by every pipeline stage (decode, ASCII conversion, file commit).
+// Each worker owns a deque: it pushes and pops its own work at the back and steals from the front
+// of the others when it runs dry, so cores move to whichever stage has work ready.
+enum class TaskStage { Decode = 0, Convert = 1, Commit = 2 };
+
+class TaskPool {
+public:
+    ~TaskPool() { stop(); }
+
+    void start(unsigned worker_count) {
+        stop();
+        stopping_ = false;
+        queues_.clear();
+        for (unsigned i = 0; i < worker_count; ++i) queues_.push_back(std::make_unique<WorkerQueue>());
+        for (unsigned i = 0; i < worker_count; ++i) threads_.emplace_back(&TaskPool::worker_loop, this, static_cast<int>(i));
+    }
+
+    // Finishes queued work, then joins the workers
+    void stop() {
+        if (threads_.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (auto& th : threads_) if (th.joinable()) th.join();
+        threads_.clear();
+    }
+
+    unsigned worker_count() const { return static_cast<unsigned>(threads_.size()); }
+
+    // Index of the calling pool worker, or -1 when called from outside the pool
+    static int current_worker() { return t_worker_index; }
+
+    void submit(TaskStage stage, std::function<void()> fn) {
+        queued_.fetch_add(1); // Counted before it is visible so wait_idle never sees a gap
+        stage_queued_[static_cast<size_t>(stage)].fetch_add(1);
+        size_t target = (t_worker_index >= 0 && t_pool == this) ? static_cast<size_t>(t_worker_index)
+                                                                 : next_queue_.fetch_add(1) % queues_.size();
+        {
+            std::lock_guard<std::mutex> lock(queues_[target]->mutex);
+            queues_[target]->tasks.push_back(Task{stage, std::move(fn)});
+        }
+        wake_one_worker();
+    }
+
+    // Shared lane where the lowest order key runs first. Progressive playback routes conversions
+    // through it so frames finish roughly in the order the player needs them.
+    void submit_ordered(TaskStage stage, long long order, std::function<void()> fn) {
+        queued_.fetch_add(1);
+        stage_queued_[static_cast<size_t>(stage)].fetch_add(1);
+        {
+            std::lock_guard<std::mutex> lock(ordered_mutex_);
+            ordered_tasks_.push_back(OrderedTask{order, Task{stage, std::move(fn)}});
+            std::push_heap(ordered_tasks_.begin(), ordered_tasks_.end(), ordered_task_after);
+        }
+        wake_one_worker();
+    }
+
+    // Run one queued task of at least min_stage on the calling thread. Lets a task that is
+    // waiting on a later stage (a decoder waiting for a free frame slot) help instead of blocking.
+    bool run_pending_task(TaskStage min_stage) {
+        Task task;
+        size_t self = (t_worker_index >= 0 && t_pool == this) ? static_cast<size_t>(t_worker_index) : 0;
+        if (!pop_task(self, min_stage, task)) return false;
+        run_task(task);
+        return true;
+    }
+
+    // Tasks of `stage` waiting to be picked up, not counting those already running
+    size_t queued(TaskStage stage) const { return stage_queued_[static_cast<size_t>(stage)].load(); }
+
+    // Block until nothing is queued or running
+    void wait_idle() {
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        idle_cv_.wait(lock, [this] { return queued_.load() == 0 && active_.load() == 0; });
+    }
+
+private:
+    struct Task {
+        TaskStage stage = TaskStage::Decode;
+        std::function<void()> fn;
+    };
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+    struct OrderedTask {
+        long long order = 0;
+        Task task;
+    };
+    static bool ordered_task_after(const OrderedTask& a, const OrderedTask& b) { return a.order > b.order; }
+
+    void wake_one_worker() {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+        }
+        work_cv_.notify_one();
+    }
+
+    void mark_taken(const Task& task) {
+        active_.fetch_add(1);
+        stage_queued_[static_cast<size_t>(task.stage)].fetch_sub(1);
+        queued_.fetch_sub(1);
+    }
+
+    bool pop_ordered_task(TaskStage min_stage, Task& out) {
+        std::lock_guard<std::mutex> lock(ordered_mutex_);
+        if (ordered_tasks_.empty() || ordered_tasks_.front().task.stage < min_stage) return false;
+        std::pop_heap(ordered_tasks_.begin(), ordered_tasks_.end(), ordered_task_after);
+        out = std::move(ordered_tasks_.back().task);
+        ordered_tasks_.pop_back();
+        mark_taken(out);
+        return true;
+    }
+
+    // Own deque newest-first, then the ordered lane, then steal oldest-first from the others
+    bool pop_task(size_t self, TaskStage min_stage, Task& out) {
+        for (size_t n = 0; n < queues_.size(); ++n) {
+            if (n == 1 && pop_ordered_task(min_stage, out)) return true;
+            size_t victim = (self + n) % queues_.size();
+            WorkerQueue& q = *queues_[victim];
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (n == 0) {
+                for (auto it = q.tasks.rbegin(); it != q.tasks.rend(); ++it) {
+                    if (it->stage < min_stage) continue;
+                    out = std::move(*it);
+                    q.tasks.erase(std::next(it).base());
+                    mark_taken(out);
+                    return true;
+                }
+            } else {
+                for (auto it = q.tasks.begin(); it != q.tasks.end(); ++it) {
+                    if (it->stage < min_stage) continue;
+                    out = std::move(*it);
+                    q.tasks.erase(it);
+                    mark_taken(out);
+                    return true;
+                }
+            }
+        }
+        return queues_.size() == 1 && pop_ordered_task(min_stage, out);
+    }
+
+    void run_task(Task& task) {
+        try {
+            task.fn();
+        } catch (const std::exception& e) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "ERROR: Pipeline task failed: " << e.what() << '\n';
+            g_pipeline_error_occurred.store(true);
+        }
+        if (active_.fetch_sub(1) == 1 && queued_.load() == 0) {
+            std::lock_guard<std::mutex> lock(sleep_mutex_);
+            idle_cv_.notify_all();
+        }
+    }
+
+    void worker_loop(int index) {
+        t_worker_index = index;
+        t_pool = this;
+        while (true) {
+            Task task;
+            if (pop_task(static_cast<size_t>(index), TaskStage::Decode, task)) {
+                run_task(task);
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleep_mutex_);
+            if (queued_.load() == 0 && stopping_) break;
+            work_cv_.wait(lock, [this] { return queued_.load() > 0 || stopping_; });
+        }
+        t_worker_index = -1;
+        t_pool = nullptr;
+    }
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues_;
+    std::vector<OrderedTask> ordered_tasks_; // Min-heap on order
+    std::mutex ordered_mutex_;
+    std::vector<std::thread> threads_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> active_{0};
+    std::array<std::atomic<size_t>, 3> stage_queued_{}; // queued_, split by TaskStage
+    std::atomic<size_t> next_queue_{0};
+    std::mutex sleep_mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable idle_cv_;
+    bool stopping_ = false;
+    static thread_local int t_worker_index;
+    static thread_local TaskPool* t_pool;
+};
+
+thread_local int TaskPool::t_worker_index = -1;
+thread_local TaskPool* TaskPool::t_pool = nullptr;
+
+TaskPool g_task_pool;
+std::atomic<int> g_decode_tasks_remaining(0); // Decode tasks not yet finished; the last one sets g_ffmpeg_extraction_done
+
+// Fixed set of preallocated raw frame buffers for stream mode. A decoder fills a free slot straight
+// from the FFmpeg pipe and hands it to a conversion task, which gives it back once the pixels are
+// no longer needed. Bounds the decoded frames in flight.
+class RawFrameRing {
+public:
+    void reset(size_t slot_count, size_t frame_bytes) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        slots_.assign(slot_count, std::vector<unsigned char>(frame_bytes));
+        frame_bytes_ = frame_bytes;
+        free_slots_.clear();
+        for (size_t i = 0; i < slot_count; ++i) free_slots_.push_back(static_cast<int>(i));
+    }
+
+    size_t frame_bytes() const { return frame_bytes_; }
+    unsigned char* data(int slot) { return slots_[static_cast<size_t>(slot)].data(); }
+
+    // Returns -1 when no slot is free
+    int try_acquire_free_slot() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_slots_.empty()) return -1;
+        int slot = free_slots_.back();
+        free_slots_.pop_back();
+        return slot;
+    }
+
+    void wait_for_free_slot(std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        free_cv_.wait_for(lock, timeout, [this] { return !free_slots_.empty() || g_pipeline_error_occurred.load(); });
+    }
+
+    void release(int slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            free_slots_.push_back(slot);
+        }
+        free_cv_.notify_one();
+    }
+
+private:
+    std::vector<std::vector<unsigned char>> slots_;
+    size_t frame_bytes_ = 0;
+    std::vector<int> free_slots_;
+    std::mutex mutex_;
+    std::condition_variable free_cv_;
+};
+
+RawFrameRing g_raw_frame_ring;
+int g_stream_frame_width = 0;  // Pixel size of the frames FFmpeg writes to the pipe
+int g_stream_frame_height = 0;
 
 // Terminal State & Process Management
 struct termios g_original_termios; // Stores original terminal settings
@@ -123,75 +445,643 @@ void print_verbose(const std::string& msg) {
     }
 }
 
-// Get file statistics as a string for hashing purposes
-std::string AnifetchArgs::get_file_stats_string_for_hashing_member(const std::string& filepath) const {
-    try {
-        // Ensure the path is absolute to handle relative paths consistently
-        std::filesystem::path p = std::filesystem::absolute(filepath);
-        if (std::filesystem::exists(p) && std::filesystem::is_regular_file(p)) {
-            auto fsize = std::filesystem::file_size(p);
-            auto fmtime = std::filesystem::last_write_time(p);
-            auto fmtime_sec = std::chrono::duration_cast<std::chrono::seconds>(fmtime.time_since_epoch());
-            return "s:" + std::to_string(fsize) + "_m:" + std::to_string(fmtime_sec.count());
+// Stats
+// --stats / --stats-json: wall time and counts for each part of a run, with log2 histograms.
+// Recording is a handful of relaxed atomic adds, and is skipped entirely unless a flag asks for it.
+enum class StatId {
+    FfprobeCall, AudioExtract, PredetermineHeight, CacheBuild, DecodeSegment, FrameHandOff,
+    FrameConvert, FrameCommit, FramePackWrite, CacheMetadataWrite,
+    FrameCompose, FrameWrite, FrameBytes, ScheduleJitter, FramesSkipped, FramesHeld,
+    FrameDecode, FrameDecodeStalls, InfoFetch, StartupToFirstFrame, TerminalResize, FrameTextSaved,
+    FrameDrain, FrameInterval, SharedTextsFill, DaemonRequest,
+    Count
+};
+
+enum class StatUnit { Nanoseconds, Bytes, Events };
+
+struct StatInfo {
+    const char* name;
+    StatUnit unit;
+};
+
+constexpr StatInfo kStatInfo[] = {
+    {"ffprobe_call", StatUnit::Nanoseconds},
+    {"audio_extract", StatUnit::Nanoseconds},
+    {"predetermine_height", StatUnit::Nanoseconds},
+    {"cache_build", StatUnit::Nanoseconds},
+    {"decode_segment", StatUnit::Nanoseconds},
+    {"frame_hand_off", StatUnit::Nanoseconds},
+    {"frame_convert", StatUnit::Nanoseconds},
+    {"frame_commit", StatUnit::Nanoseconds},
+    {"frame_pack_write", StatUnit::Nanoseconds},
+    {"cache_metadata_write", StatUnit::Nanoseconds},
+    {"frame_compose", StatUnit::Nanoseconds},
+    {"frame_write", StatUnit::Nanoseconds},
+    {"frame_bytes", StatUnit::Bytes},
+    {"schedule_jitter", StatUnit::Nanoseconds},
+    {"frames_skipped", StatUnit::Events},
+    {"frames_held", StatUnit::Events},
+    {"frame_decode", StatUnit::Nanoseconds},
+    {"frame_decode_stalls", StatUnit::Events},
+    {"info_fetch", StatUnit::Nanoseconds},
+    {"startup_to_first_frame", StatUnit::Nanoseconds},
+    {"terminal_resize", StatUnit::Nanoseconds},
+    {"frame_text_saved", StatUnit::Bytes},
+    {"frame_drain", StatUnit::Nanoseconds},
+    {"frame_interval", StatUnit::Nanoseconds},
+    {"shared_texts_fill", StatUnit::Nanoseconds},
+    {"daemon_request", StatUnit::Nanoseconds},
+};
+static_assert(sizeof(kStatInfo) / sizeof(kStatInfo[0]) == static_cast<size_t>(StatId::Count), "kStatInfo must cover StatId");
+
+// Bucket k counts values in [2^(k-1), 2^k) of the base unit (microseconds for times); bucket 0 is 0
+constexpr int kStatBuckets = 40;
+
+struct StatSlot {
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> max{0};
+    std::atomic<uint64_t> buckets[kStatBuckets] = {};
+};
+
+bool g_stats_enabled = false;
+StatSlot g_stats[static_cast<size_t>(StatId::Count)];
+
+void stat_record(StatId id, uint64_t value) {
+    if (!g_stats_enabled) return;
+    StatSlot& slot = g_stats[static_cast<size_t>(id)];
+    slot.count.fetch_add(1, std::memory_order_relaxed);
+    slot.total.fetch_add(value, std::memory_order_relaxed);
+    uint64_t seen = slot.max.load(std::memory_order_relaxed);
+    while (value > seen && !slot.max.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {}
+    uint64_t scaled = kStatInfo[static_cast<size_t>(id)].unit == StatUnit::Nanoseconds ? value / 1000 : value;
+    int bucket = 0;
+    while (scaled > 0 && bucket < kStatBuckets - 1) {
+        scaled >>= 1;
+        bucket++;
+    }
+    slot.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Process start-up, as close to exec as static initialization gets
+const std::chrono::steady_clock::time_point g_process_start = std::chrono::steady_clock::now();
+
+uint64_t stat_elapsed_ns(std::chrono::steady_clock::time_point since) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - since).count());
+}
+
+// Records the lifetime of the scope as one sample
+class ScopedStatTimer {
+public:
+    explicit ScopedStatTimer(StatId id) : id_(id), start_(g_stats_enabled ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()) {}
+    ~ScopedStatTimer() { if (g_stats_enabled) stat_record(id_, stat_elapsed_ns(start_)); }
+    ScopedStatTimer(const ScopedStatTimer&) = delete;
+    ScopedStatTimer& operator=(const ScopedStatTimer&) = delete;
+
+private:
+    StatId id_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+// Upper edge of the bucket holding the percentile, in the stat's own unit and capped at the observed max
+uint64_t stat_percentile(const StatSlot& slot, StatUnit unit, double fraction) {
+    uint64_t count = slot.count.load();
+    if (count == 0) return 0;
+    const uint64_t max = slot.max.load();
+    const uint64_t scale = unit == StatUnit::Nanoseconds ? 1000 : 1;
+    uint64_t target = static_cast<uint64_t>(std::ceil(fraction * static_cast<double>(count)));
+    uint64_t seen = 0;
+    for (int b = 0; b < kStatBuckets; ++b) {
+        seen += slot.buckets[b].load();
+        if (seen >= target) return b == 0 ? 0 : std::min<uint64_t>(((1ULL << b) - 1) * scale, max);
+    }
+    return max;
+}
+
+std::string format_stat_value(StatUnit unit, double value) {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(2);
+    if (unit == StatUnit::Nanoseconds) {
+        if (value >= 1e9) oss << value / 1e9 << " s";
+        else if (value >= 1e6) oss << value / 1e6 << " ms";
+        else oss << value / 1e3 << " us";
+    } else if (unit == StatUnit::Bytes) {
+        oss << std::setprecision(0) << value << " B";
+    } else {
+        oss << std::setprecision(0) << value;
+    }
+    return oss.str();
+}
+
+// Human summary on stderr for --stats, JSON file for --stats-json
+void report_stats(bool print_summary, const std::string& json_path) {
+    if (print_summary) {
+        std::ostringstream out;
+        out << "\nanifetch stats\n";
+        out << std::left << std::setw(22) << "stage" << std::right << std::setw(9) << "count" << std::setw(13) << "total"
+            << std::setw(13) << "mean" << std::setw(13) << "p50" << std::setw(13) << "p99" << std::setw(13) << "max" << '\n';
+        for (size_t i = 0; i < static_cast<size_t>(StatId::Count); ++i) {
+            const StatSlot& slot = g_stats[i];
+            uint64_t count = slot.count.load();
+            if (count == 0) continue;
+            StatUnit unit = kStatInfo[i].unit;
+            if (unit == StatUnit::Events) {
+                // A sample may stand for several events (a run of skipped frames)
+                out << std::left << std::setw(22) << kStatInfo[i].name << std::right << std::setw(9) << slot.total.load() << '\n';
+                continue;
+            }
+            out << std::left << std::setw(22) << kStatInfo[i].name << std::right << std::setw(9) << count;
+            out << std::setw(13) << format_stat_value(unit, static_cast<double>(slot.total.load()))
+                << std::setw(13) << format_stat_value(unit, static_cast<double>(slot.total.load()) / static_cast<double>(count))
+                << std::setw(13) << format_stat_value(unit, static_cast<double>(stat_percentile(slot, unit, 0.50)))
+                << std::setw(13) << format_stat_value(unit, static_cast<double>(stat_percentile(slot, unit, 0.99)))
+                << std::setw(13) << format_stat_value(unit, static_cast<double>(slot.max.load())) << '\n';
         }
-    } catch (const std::filesystem::filesystem_error& e) {
-        return "file_stat_error_or_missing_" + filepath;
+        const StatSlot& interval = g_stats[static_cast<size_t>(StatId::FrameInterval)];
+        if (interval.count.load() > 0 && interval.total.load() > 0) {
+            out << "effective playback rate: " << std::fixed << std::setprecision(2)
+                << 1e9 * static_cast<double>(interval.count.load()) / static_cast<double>(interval.total.load()) << " fps\n";
+        }
+        std::cerr << out.str() << std::flush;
+    }
+
+    if (!json_path.empty()) {
+        std::ofstream json(json_path, std::ios::trunc);
+        if (!json.is_open()) {
+            std::cerr << "Warning: Could not write stats to " << json_path << '\n';
+            return;
+        }
+        json << "{\n  \"histogram_bucket\": \"bucket k holds values in [2^(k-1), 2^k) microseconds (times) or units (bytes); bucket 0 holds 0\",\n";
+        json << "  \"stats\": {";
+        bool first = true;
+        for (size_t i = 0; i < static_cast<size_t>(StatId::Count); ++i) {
+            const StatSlot& slot = g_stats[i];
+            StatUnit unit = kStatInfo[i].unit;
+            json << (first ? "\n" : ",\n") << "    \"" << kStatInfo[i].name << "\": {\"unit\": \""
+                 << (unit == StatUnit::Nanoseconds ? "ns" : unit == StatUnit::Bytes ? "bytes" : "events") << "\", \"count\": "
+                 << (unit == StatUnit::Events ? slot.total.load() : slot.count.load());
+            first = false;
+            if (unit != StatUnit::Events) {
+                json << ", \"total\": " << slot.total.load() << ", \"max\": " << slot.max.load() << ", \"histogram\": [";
+                int last = kStatBuckets - 1;
+                while (last > 0 && slot.buckets[last].load() == 0) last--;
+                for (int b = 0; b <= last; ++b) json << (b ? ", " : "") << slot.buckets[b].load();
+                json << "]";
+            }
+            json << "}";
+        }
+        json << "\n  }";
+        const StatSlot& interval = g_stats[static_cast<size_t>(StatId::FrameInterval)];
+        if (interval.count.load() > 0 && interval.total.load() > 0) {
+            json << ",\n  \"effective_fps\": " << std::fixed << std::setprecision(3)
+                 << 1e9 * static_cast<double>(interval.count.load()) / static_cast<double>(interval.total.load());
+        }
+        json << "\n}\n";
     }
-    return "file_not_found_or_not_regular_" + filepath;
 }
 
+// Hashing
+// XXH64, kept in-tree so cache keys stay identical across compilers, standard libraries and rebuilds
+// (std::hash promises none of that).
+constexpr uint64_t kXxhPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kXxhPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kXxhPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kXxhPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kXxhPrime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t xxh_rotl64(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+inline uint64_t xxh_read64(const unsigned char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap64(v);
+#endif
+    return v;
+}
+
+inline uint32_t xxh_read32(const unsigned char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    return v;
+}
+
+inline uint64_t xxh64_round(uint64_t acc, uint64_t input) {
+    acc += input * kXxhPrime2;
+    acc = xxh_rotl64(acc, 31);
+    return acc * kXxhPrime1;
+}
+
+inline uint64_t xxh64_merge_round(uint64_t acc, uint64_t val) {
+    acc ^= xxh64_round(0, val);
+    return acc * kXxhPrime1 + kXxhPrime4;
+}
 
-// Execute a command, optionally suppressing its output
-// Returns command's exit code
-int run_command_silent_ex(const std::string& command_str, bool suppress_output_even_if_verbose = false) {
-    print_verbose("Executing: " + command_str);
-    std::string cmd_to_run = command_str;
-    if (!g_args.verbose || suppress_output_even_if_verbose) {
-        cmd_to_run += " > /dev/null 2>&1";
+uint64_t xxhash64(const void* data, size_t len, uint64_t seed = 0) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const unsigned char* const end = p + len;
+    uint64_t h64;
+    if (len >= 32) {
+        uint64_t v1 = seed + kXxhPrime1 + kXxhPrime2;
+        uint64_t v2 = seed + kXxhPrime2;
+        uint64_t v3 = seed;
+        uint64_t v4 = seed - kXxhPrime1;
+        const unsigned char* const limit = end - 32;
+        do {
+            v1 = xxh64_round(v1, xxh_read64(p)); p += 8;
+            v2 = xxh64_round(v2, xxh_read64(p)); p += 8;
+            v3 = xxh64_round(v3, xxh_read64(p)); p += 8;
+            v4 = xxh64_round(v4, xxh_read64(p)); p += 8;
+        } while (p <= limit);
+        h64 = xxh_rotl64(v1, 1) + xxh_rotl64(v2, 7) + xxh_rotl64(v3, 12) + xxh_rotl64(v4, 18);
+        h64 = xxh64_merge_round(h64, v1);
+        h64 = xxh64_merge_round(h64, v2);
+        h64 = xxh64_merge_round(h64, v3);
+        h64 = xxh64_merge_round(h64, v4);
+    } else {
+        h64 = seed + kXxhPrime5;
     }
-    int sys_ret = system(cmd_to_run.c_str());
-    int exit_code = 0;
-    if (WIFEXITED(sys_ret)) {
-        exit_code = WEXITSTATUS(sys_ret);
+    h64 += static_cast<uint64_t>(len);
+    while (p + 8 <= end) {
+        h64 ^= xxh64_round(0, xxh_read64(p));
+        h64 = xxh_rotl64(h64, 27) * kXxhPrime1 + kXxhPrime4;
+        p += 8;
+    }
+    if (p + 4 <= end) {
+        h64 ^= static_cast<uint64_t>(xxh_read32(p)) * kXxhPrime1;
+        h64 = xxh_rotl64(h64, 23) * kXxhPrime2 + kXxhPrime3;
+        p += 4;
+    }
+    while (p < end) {
+        h64 ^= (*p) * kXxhPrime5;
+        h64 = xxh_rotl64(h64, 11) * kXxhPrime1;
+        ++p;
+    }
+    h64 ^= h64 >> 33;
+    h64 *= kXxhPrime2;
+    h64 ^= h64 >> 29;
+    h64 *= kXxhPrime3;
+    h64 ^= h64 >> 32;
+    return h64;
+}
+
+std::string hash_to_hex(uint64_t hash) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(hash));
+    return buffer;
+}
+
+// Content identity of the input video: its size plus XXH64 over evenly spaced 64 KiB blocks (the whole
+// file when it is small). Unlike size + mtime it survives touch, copies and file syncs.
+constexpr size_t kIdentityBlockSize = 64 * 1024;
+constexpr size_t kIdentityBlockCount = 16;
+
+std::string compute_video_identity(const std::string& filepath) {
+    std::error_code ec;
+    std::filesystem::path p = std::filesystem::absolute(filepath, ec);
+    if (ec || !std::filesystem::is_regular_file(p, ec)) return "file_not_found_or_not_regular_" + filepath;
+    const uint64_t fsize = std::filesystem::file_size(p, ec);
+    std::ifstream video_stream(p, std::ios::binary);
+    if (ec || !video_stream.is_open()) return "file_stat_error_or_missing_" + filepath;
+
+    std::string samples;
+    if (fsize <= kIdentityBlockSize * kIdentityBlockCount) {
+        samples.assign(std::istreambuf_iterator<char>(video_stream), std::istreambuf_iterator<char>());
     } else {
-        exit_code = -1; // Abnormal termination
+        samples.resize(kIdentityBlockSize * kIdentityBlockCount);
+        const uint64_t last_offset = fsize - kIdentityBlockSize;
+        for (size_t i = 0; i < kIdentityBlockCount; ++i) {
+            uint64_t offset = last_offset * i / (kIdentityBlockCount - 1); // First and last block included
+            video_stream.seekg(static_cast<std::streamoff>(offset));
+            if (!video_stream.read(&samples[i * kIdentityBlockSize], kIdentityBlockSize)) return "file_read_error_" + filepath;
+        }
+    }
+    return "s:" + std::to_string(fsize) + "_x:" + hash_to_hex(xxhash64(samples.data(), samples.size(), fsize));
+}
+
+// Spell equivalent Chafa argument strings the same way (whitespace runs, --opt=value vs --opt value)
+// so they share a cache entry. Strings with quoting are left alone; split_shell_words reads them.
+std::string normalize_chafa_arguments(const std::string& arguments) {
+    if (arguments.find_first_of("'\"\\") != std::string::npos) return arguments;
+    std::istringstream token_stream(arguments);
+    std::string token, normalized;
+    while (token_stream >> token) {
+        size_t eq = token.find('=');
+        if (token.rfind("--", 0) == 0 && eq != std::string::npos && eq > 2) token[eq] = ' ';
+        if (!normalized.empty()) normalized += ' ';
+        normalized += token;
+    }
+    return normalized;
+}
+
+// Split an argument string into words the way sh does, minus expansions: whitespace separates words,
+// '...' and "..." group, and a backslash escapes the next character (inside "..." only \\, \", \$ and \`).
+// Returns false on an unterminated quote.
+bool split_shell_words(const std::string& text, std::vector<std::string>& words) {
+    words.clear();
+    std::string word;
+    bool in_word = false;
+    for (size_t i = 0; i < text.size(); ++i) {
+        const char c = text[i];
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            if (in_word) words.push_back(std::move(word));
+            word.clear();
+            in_word = false;
+            continue;
+        }
+        in_word = true;
+        if (c == '\'') {
+            size_t close = text.find('\'', i + 1);
+            if (close == std::string::npos) return false;
+            word.append(text, i + 1, close - i - 1);
+            i = close;
+        } else if (c == '"') {
+            for (++i; i < text.size() && text[i] != '"'; ++i) {
+                if (text[i] == '\\' && i + 1 < text.size() && std::strchr("\\\"$`", text[i + 1])) ++i;
+                word += text[i];
+            }
+            if (i >= text.size()) return false;
+        } else if (c == '\\' && i + 1 < text.size()) {
+            word += text[++i];
+        } else {
+            word += c;
+        }
+    }
+    if (in_word) words.push_back(std::move(word));
+    return true;
+}
+
+
+// Subprocesses
+// External tools run straight through posix_spawnp with an argument vector: no /bin/sh in between and
+// nothing to quote. Every pipe is close-on-exec, so children spawned concurrently by other workers
+// never hold each other's pipes open.
+
+constexpr int kToolTimeoutMs = 30000; // Probes, conversions and fastfetch; a tool silent this long is stuck
+
+// The command as it would be typed, for logs and error messages
+std::string describe_command(const std::vector<std::string>& argv) {
+    std::string text;
+    for (const auto& arg : argv) {
+        if (!text.empty()) text += ' ';
+        text += arg.find_first_of(" \t\"'") == std::string::npos ? arg : "\"" + arg + "\"";
     }
+    return text;
+}
 
-    if (exit_code != 0) {
+// Start argv[0] (looked up in PATH) with stdin_fd/stdout_fd as its stdin/stdout; -1 means /dev/null for
+// stdin and, when quiet, for stdout (otherwise it is inherited). stderr goes to /dev/null when quiet.
+// Returns the child's pid, or -1.
+pid_t spawn_process(const std::vector<std::string>& argv, int stdin_fd, int stdout_fd, bool quiet) {
+    std::vector<char*> c_argv;
+    for (const auto& arg : argv) c_argv.push_back(const_cast<char*>(arg.c_str()));
+    c_argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (stdin_fd >= 0) posix_spawn_file_actions_adddup2(&actions, stdin_fd, STDIN_FILENO);
+    else posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0); // FFmpeg would read keys from the terminal
+    if (stdout_fd >= 0) posix_spawn_file_actions_adddup2(&actions, stdout_fd, STDOUT_FILENO);
+    else if (quiet) posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    if (quiet) posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    // Children start with no blocked signals and default SIGPIPE, whatever the spawning thread has set
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t no_signals, default_signals;
+    sigemptyset(&no_signals);
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGPIPE);
+    posix_spawnattr_setsigmask(&attr, &no_signals);
+    posix_spawnattr_setsigdefault(&attr, &default_signals);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    pid_t pid = -1;
+    int err = posix_spawnp(&pid, c_argv[0], &actions, &attr, c_argv.data(), environ);
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&actions);
+    if (err != 0) {
         std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ERROR: Command failed with exit code " << exit_code << ": " << command_str << '\n';
+        std::cerr << "ERROR: Could not start " << argv[0] << ": " << strerror(err) << '\n';
+        return -1;
     }
-    return exit_code;
+    return pid;
+}
+
+int exit_code_of(int wait_status) {
+    return WIFEXITED(wait_status) ? WEXITSTATUS(wait_status) : -1;
 }
 
-// Execute a command and capture its stdout
-std::string run_command_with_output_ex(const std::string& command_str) {
-    print_verbose("Executing for output: " + command_str);
-    std::string result = "";
-    FILE* pipe = popen(command_str.c_str(), "r");
-    if (!pipe) {
+struct SubprocessOptions {
+    const std::string_view* input = nullptr;   // Fed to the child's stdin when set (otherwise /dev/null)
+    std::string* output = nullptr;             // Receives the child's stdout when set; its capacity is reused
+    bool quiet = false;                        // stderr, and stdout unless captured, go to /dev/null
+    int timeout_ms = 0;                        // Kill the child once it has read and written nothing for this long; 0 for no limit
+    const std::atomic<bool>* cancel = nullptr; // Kill the child once this becomes true
+    bool timed_out = false;                    // Set on return
+    bool cancelled = false;                    // Set on return
+};
+
+// Run a tool to completion, feeding and draining its pipes from one poll loop so neither side can stall
+// the other. The child is reaped without blocking, so a timeout or cancellation is noticed even if it
+// closes its pipes and hangs. Every read or write restarts the timeout, so a tool that is slow but
+// busy runs to the end. Returns its exit code, or -1 if it didn't start, died of a signal, timed out
+// or was cancelled.
+int run_subprocess(const std::vector<std::string>& argv, SubprocessOptions& options) {
+    int in_pipe[2] = {-1, -1}, out_pipe[2] = {-1, -1};
+    if ((options.input && pipe2(in_pipe, O_CLOEXEC) != 0) || (options.output && pipe2(out_pipe, O_CLOEXEC) != 0)) {
         std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ERROR: popen() failed for command: " << command_str << " Error: " << strerror(errno) << '\n';
-        return "";
+        std::cerr << "ERROR: pipe() failed for " << argv[0] << ": " << strerror(errno) << '\n';
+        for (int fd : {in_pipe[0], in_pipe[1]}) if (fd >= 0) close(fd);
+        return -1;
     }
-    char buffer[2048];
-    while (fgets(buffer, sizeof(buffer), pipe) != nullptr) {
-        result += buffer;
+    if (options.output) options.output->clear();
+    const pid_t pid = spawn_process(argv, in_pipe[0], out_pipe[1], options.quiet);
+    for (int fd : {in_pipe[0], out_pipe[1]}) if (fd >= 0) close(fd);
+    int in_fd = in_pipe[1], out_fd = out_pipe[0];
+    if (pid < 0) {
+        for (int fd : {in_fd, out_fd}) if (fd >= 0) close(fd);
+        return -1;
     }
-    int exit_status = pclose(pipe);
-    if (WIFEXITED(exit_status)) {
-        int actual_exit_code = WEXITSTATUS(exit_status);
-        if (actual_exit_code != 0) {
-            std::lock_guard<std::mutex> lock(g_cerr_mutex);
-            std::cerr << "WARNING: Command '" << command_str << "' finished with non-zero exit code: " << actual_exit_code << ". Output (if any): " << result << '\n';
+    if (in_fd >= 0) fcntl(in_fd, F_SETFL, fcntl(in_fd, F_GETFL) | O_NONBLOCK);
+
+    // A child that exits without reading all its input must not take this process down with SIGPIPE
+    sigset_t sigpipe_set, saved_mask;
+    sigemptyset(&sigpipe_set);
+    sigaddset(&sigpipe_set, SIGPIPE);
+    const bool feeding = in_fd >= 0;
+    if (feeding) pthread_sigmask(SIG_BLOCK, &sigpipe_set, &saved_mask);
+
+    // The child's exit wakes the poll below through a pidfd; without one (kernels before 5.3), poll for it
+    int pid_fd = -1;
+#ifdef SYS_pidfd_open
+    pid_fd = static_cast<int>(syscall(SYS_pidfd_open, pid, 0));
+#endif
+    const auto timeout = std::chrono::milliseconds(options.timeout_ms);
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    size_t fed = 0;
+    int wait_status = 0;
+    bool killed = false, reaped = false;
+    char buffer[16384];
+    while (!reaped || out_fd >= 0 || in_fd >= 0) {
+        if (!killed && !reaped) {
+            options.cancelled = options.cancel && options.cancel->load();
+            options.timed_out = options.timeout_ms > 0 && std::chrono::steady_clock::now() >= deadline;
+            if (options.cancelled || options.timed_out) {
+                kill(pid, SIGKILL);
+                killed = true;
+            }
+        }
+        pollfd fds[3];
+        nfds_t nfds = 0;
+        if (out_fd >= 0) fds[nfds++] = {out_fd, POLLIN, 0};
+        if (in_fd >= 0) fds[nfds++] = {in_fd, POLLOUT, 0};
+        if (pid_fd >= 0) fds[nfds++] = {pid_fd, POLLIN, 0};
+        if (pid_fd < 0 && !reaped) {
+            pid_t waited = waitpid(pid, &wait_status, WNOHANG);
+            reaped = waited == pid || (waited < 0 && errno != EINTR);
+        }
+        // Once the child is gone, only take what is already in the pipes: a grandchild may hold them open
+        const int wait_ms = reaped ? 0 : nfds == 0 ? 1 : 50;
+        const int ready = poll(fds, nfds, wait_ms);
+        if (ready == 0 && reaped) break;
+        if (ready <= 0) continue;
+        for (nfds_t i = 0; i < nfds; ++i) {
+            if (fds[i].revents == 0) continue;
+            if (fds[i].fd == pid_fd) {
+                pid_t waited = waitpid(pid, &wait_status, WNOHANG);
+                reaped = waited == pid || (waited < 0 && errno != EINTR);
+                if (reaped) {
+                    close(pid_fd);
+                    pid_fd = -1;
+                }
+            } else if (fds[i].fd == out_fd) {
+                ssize_t got = read(out_fd, buffer, sizeof(buffer));
+                if (got > 0) {
+                    options.output->append(buffer, static_cast<size_t>(got));
+                    deadline = std::chrono::steady_clock::now() + timeout;
+                } else if (got == 0 || (errno != EINTR && errno != EAGAIN)) {
+                    close(out_fd);
+                    out_fd = -1;
+                }
+            } else {
+                const std::string_view& input = *options.input;
+                ssize_t put = fds[i].revents & POLLOUT ? write(in_fd, input.data() + fed, input.size() - fed) : -1;
+                if (put > 0) {
+                    fed += static_cast<size_t>(put);
+                    deadline = std::chrono::steady_clock::now() + timeout;
+                }
+                if (fed == input.size() || (put < 0 && errno != EINTR && errno != EAGAIN)) {
+                    close(in_fd); // All written, or the child stopped reading
+                    in_fd = -1;
+                }
+            }
         }
-    } else {
-         std::lock_guard<std::mutex> lock(g_cerr_mutex);
-         std::cerr << "WARNING: Command '" << command_str << "' did not terminate normally.\n";
     }
-    return result;
+    for (int fd : {out_fd, in_fd, pid_fd}) if (fd >= 0) close(fd);
+    if (feeding) {
+        const timespec no_wait = {0, 0};
+        while (sigtimedwait(&sigpipe_set, nullptr, &no_wait) > 0) {} // Drop the SIGPIPE a short write raised
+        pthread_sigmask(SIG_SETMASK, &saved_mask, nullptr);
+    }
+    return killed ? -1 : exit_code_of(wait_status);
+}
+
+// Run a tool for its side effects, with its output shown only in verbose mode (never if
+// suppress_output_even_if_verbose). Returns its exit code; failures are reported unless cancelled.
+int run_command_silent_ex(const std::vector<std::string>& argv, bool suppress_output_even_if_verbose = false,
+                          const std::atomic<bool>* cancel = nullptr) {
+    print_verbose("Executing: " + describe_command(argv));
+    SubprocessOptions options;
+    options.quiet = !g_args.verbose || suppress_output_even_if_verbose;
+    options.cancel = cancel;
+    int exit_code = run_subprocess(argv, options);
+    if (exit_code != 0 && !options.cancelled) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ERROR: Command failed with exit code " << exit_code << ": " << describe_command(argv) << '\n';
+    }
+    return exit_code;
+}
+
+// Run a tool and capture its stdout (into `output`, reusing its capacity)
+bool run_command_with_output_ex(const std::vector<std::string>& argv, std::string& output,
+                                const std::string_view* input = nullptr, const std::atomic<bool>* cancel = nullptr) {
+    print_verbose("Executing for output: " + describe_command(argv));
+    SubprocessOptions options;
+    options.input = input;
+    options.output = &output;
+    options.timeout_ms = kToolTimeoutMs;
+    options.cancel = cancel;
+    int exit_code = run_subprocess(argv, options);
+    if (exit_code != 0 && !options.cancelled) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        if (options.timed_out) {
+            std::cerr << "WARNING: Command '" << describe_command(argv) << "' was stopped after " << kToolTimeoutMs / 1000 << "s without reading or writing anything.\n";
+        } else if (exit_code < 0) {
+            std::cerr << "WARNING: Command '" << describe_command(argv) << "' did not terminate normally.\n";
+        } else {
+            std::cerr << "WARNING: Command '" << describe_command(argv) << "' finished with non-zero exit code: " << exit_code << ". Output (if any): " << output << '\n';
+        }
+    }
+    return exit_code == 0;
+}
+
+std::string run_command_with_output_ex(const std::vector<std::string>& argv) {
+    std::string output;
+    run_command_with_output_ex(argv, output);
+    return output;
 }
 
+// A tool whose stdout is read as a stream, like FFmpeg writing raw frames
+class SubprocessReader {
+public:
+    ~SubprocessReader() { finish(true); }
+
+    bool start(const std::vector<std::string>& argv, bool quiet) {
+        int out_pipe[2];
+        if (pipe2(out_pipe, O_CLOEXEC) != 0) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "ERROR: pipe() failed for " << argv[0] << ": " << strerror(errno) << '\n';
+            return false;
+        }
+        pid_ = spawn_process(argv, -1, out_pipe[1], quiet);
+        close(out_pipe[1]);
+        fd_ = out_pipe[0];
+        if (pid_ < 0) finish(true);
+        return pid_ >= 0;
+    }
+
+    // Fill `size` bytes; returns how many arrived before end of output
+    size_t read_exact(void* data, size_t size) {
+        size_t got = 0;
+        while (fd_ >= 0 && got < size) {
+            ssize_t n = read(fd_, static_cast<char*>(data) + got, size - got);
+            if (n > 0) got += static_cast<size_t>(n);
+            else if (n == 0 || errno != EINTR) break;
+        }
+        return got;
+    }
+
+    // Close the pipe and reap the child, killing it first if `stop`. Returns its exit code, or -1.
+    int finish(bool stop) {
+        if (fd_ >= 0) close(fd_);
+        fd_ = -1;
+        if (pid_ < 0) return -1;
+        if (stop) kill(pid_, SIGKILL);
+        int wait_status = 0;
+        while (waitpid(pid_, &wait_status, 0) < 0 && errno == EINTR) {}
+        pid_ = -1;
+        return stop ? -1 : exit_code_of(wait_status);
+    }
+
+private:
+    pid_t pid_ = -1;
+    int fd_ = -1;
+};
+
 // Generate a hash string from a map of arguments
 std::string hash_args_map(const std::map<std::string, std::string>& args_map) {
     std::string combined_string;
@@ -199,7 +1089,7 @@ std::string hash_args_map(const std::map<std::string, std::string>& args_map) {
     for (const auto& pair : args_map) keys.push_back(pair.first);
     std::sort(keys.begin(), keys.end()); // Ensure consistent order
     for (const auto& key : keys) combined_string += key + "=" + args_map.at(key) + ";";
-    return std::to_string(std::hash<std::string>{}(combined_string));
+    return hash_to_hex(xxhash64(combined_string.data(), combined_string.size()));
 }
 
 // Parse simple key-value pairs from cache.txt
@@ -239,84 +1129,1977 @@ std::map<std::string, std::string> parse_cache_txt(const std::filesystem::path&
 }
 
 
-// Map audio codec name to common file extension
-std::string get_ext_from_codec(const std::string& codec) {
-    static const std::map<std::string, std::string> codec_extension_map = {
-        {"aac", "m4a"}, {"mp3", "mp3"}, {"opus", "opus"}, {"vorbis", "ogg"},
-        {"pcm_s16le", "wav"}, {"flac", "flac"}, {"alac", "m4a"}
-    };
-    auto it = codec_extension_map.find(codec);
-    return (it != codec_extension_map.end()) ? it->second : "bin"; // Default
-}
+// Frame Deltas
+// Frames are parsed into cell grids so consecutive frames can be diffed at cache time.
+// A delta is a list of ops, each one a (row, col) cell position plus the bytes that redraw
+// a span of changed cells starting there. Playback then only writes what changed.
 
-// Use ffprobe to check audio codec of a file
-std::string check_codec_of_file(const std::string& file_path) {
-    std::string cmd = "ffprobe -v error -select_streams a:0 -show_entries stream=codec_name -of default=nokey=1:noprint_wrappers=1 \"" + file_path + "\"";
-    std::string result = run_command_with_output_ex(cmd);
-    if (!result.empty() && result.back() == '\n') result.pop_back(); // Trim newline
-    return result;
-}
+struct CellStyle {
+    uint8_t fg_kind = 0; // 0 = default, 1 = indexed, 2 = truecolor
+    uint8_t bg_kind = 0;
+    uint8_t attrs = 0;   // Bit per SGR attribute: bold, dim, italic, underline, blink, inverse
+    uint32_t fg = 0;
+    uint32_t bg = 0;
 
-// Extract audio stream from video file using ffmpeg
-std::string extract_audio_from_file(const std::string& input_file, const std::string& extension, const std::filesystem::path& dest_dir) {
-    std::filesystem::path audio_file_path = dest_dir / ("output_audio." + extension);
-    std::string cmd = "ffmpeg -i \"" + input_file + "\" -y -vn -c:a copy -loglevel error \"" + audio_file_path.string() + "\"";
-    print_verbose("Extracting audio: " + cmd);
-    int sys_ret = ::system((cmd + (g_args.verbose ? "" : " > /dev/null 2>&1")).c_str());
-    if (WIFEXITED(sys_ret) && WEXITSTATUS(sys_ret) != 0) {
-        std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ffmpeg audio extraction failed (exit code " << WEXITSTATUS(sys_ret) << ").\n";
-        return "";
-    } else if (!WIFEXITED(sys_ret)) {
-        std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ffmpeg audio extraction did not exit normally.\n";
-        return "";
+    bool operator==(const CellStyle& o) const {
+        return fg_kind == o.fg_kind && bg_kind == o.bg_kind && attrs == o.attrs && fg == o.fg && bg == o.bg;
     }
-    return audio_file_path.string();
-}
+    bool operator!=(const CellStyle& o) const { return !(*this == o); }
+};
 
-// Get video duration using ffprobe
-double get_video_duration_ex(const std::string& filename) {
-    print_verbose("Probing video duration for: " + filename);
-    std::string cmd = "ffprobe -v error -show_entries format=duration -of default=noprint_wrappers=1:nokey=1 \"" + filename + "\"";
-    std::string output = run_command_with_output_ex(cmd);
-    try {
-        if (!output.empty()) return std::stod(output);
-    } catch (const std::exception& e) {
-        std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ERROR: Failed to parse video duration from ffprobe output '" << output << "'. Error: " << e.what() << '\n';
+struct Cell {
+    CellStyle style;
+    char glyph[4] = {' ', 0, 0, 0}; // One UTF-8 code point
+    uint8_t glyph_len = 1;
+
+    bool operator==(const Cell& o) const {
+        return glyph_len == o.glyph_len && std::memcmp(glyph, o.glyph, glyph_len) == 0 && style == o.style;
     }
-    return 0.0; // Indicate failure
-}
+    bool operator!=(const Cell& o) const { return !(*this == o); }
+};
 
-// Determine actual Chafa output height by processing one frame
-bool predetermine_actual_chafa_height() {
-    if (g_pipeline_error_occurred.load()) return false;
-    print_verbose("Predetermining actual Chafa height...");
-    std::filesystem::path temp_first_frame_dir = g_current_args_cache_dir / "temp_first_frame_extract_for_height";
-    std::filesystem::create_directories(temp_first_frame_dir);
+constexpr uint8_t kAttrBits[] = {1, 2, 3, 4, 5, 7}; // SGR codes that set each attribute bit
 
-    std::ostringstream first_frame_oss;
-    first_frame_oss << std::setfill('0') << std::setw(9) << 1 << ".png";
-    std::filesystem::path first_png_path = temp_first_frame_dir / first_frame_oss.str();
+// Apply one SGR parameter list (the text between "\033[" and "m") to a style
+void apply_sgr_params(const std::string_view params, CellStyle& style) {
+    std::vector<int> codes;
+    int value = 0;
+    bool have_digit = false;
+    for (char ch : params) {
+        if (ch >= '0' && ch <= '9') { value = value * 10 + (ch - '0'); have_digit = true; }
+        else if (ch == ';' || ch == ':') { codes.push_back(have_digit ? value : 0); value = 0; have_digit = false; }
+    }
+    codes.push_back(have_digit ? value : 0);
+
+    for (size_t i = 0; i < codes.size(); ++i) {
+        int code = codes[i];
+        if (code == 0) { style = CellStyle{}; continue; }
+        bool handled = false;
+        for (size_t bit = 0; bit < sizeof(kAttrBits); ++bit) {
+            if (code == kAttrBits[bit]) { style.attrs |= static_cast<uint8_t>(1u << bit); handled = true; }
+            else if (code == 20 + kAttrBits[bit] || (code == 22 && kAttrBits[bit] <= 2)) { style.attrs &= static_cast<uint8_t>(~(1u << bit)); handled = true; }
+        }
+        if (handled) continue;
+        if ((code >= 30 && code <= 37) || (code >= 90 && code <= 97)) { style.fg_kind = 1; style.fg = static_cast<uint32_t>(code >= 90 ? code - 90 + 8 : code - 30); }
+        else if ((code >= 40 && code <= 47) || (code >= 100 && code <= 107)) { style.bg_kind = 1; style.bg = static_cast<uint32_t>(code >= 100 ? code - 100 + 8 : code - 40); }
+        else if (code == 39) { style.fg_kind = 0; style.fg = 0; }
+        else if (code == 49) { style.bg_kind = 0; style.bg = 0; }
+        else if ((code == 38 || code == 48) && i + 1 < codes.size()) {
+            uint8_t& kind = (code == 38) ? style.fg_kind : style.bg_kind;
+            uint32_t& color = (code == 38) ? style.fg : style.bg;
+            if (codes[i + 1] == 5 && i + 2 < codes.size()) {
+                kind = 1; color = static_cast<uint32_t>(codes[i + 2]) & 0xFF; i += 2;
+            } else if (codes[i + 1] == 2 && i + 4 < codes.size()) {
+                kind = 2;
+                color = ((static_cast<uint32_t>(codes[i + 2]) & 0xFF) << 16) | ((static_cast<uint32_t>(codes[i + 3]) & 0xFF) << 8) | (static_cast<uint32_t>(codes[i + 4]) & 0xFF);
+                i += 4;
+            }
+        }
+    }
+}
 
-    std::string ffmpeg_filter_complex = "fps=" + std::to_string(g_args.framerate);
-    if (g_args.chroma_flag_given) {
-        ffmpeg_filter_complex += ",format=rgba,colorkey=" + g_args.chroma_arg + ":similarity=0.01:blend=0";
-    } else {
-        ffmpeg_filter_complex += ",format=rgb24"; // Default format
+// Shortest SGR parameters selecting one colour: the 16 basic colours have their own codes
+void append_color_params(std::string& params, bool background, uint8_t kind, uint32_t color) {
+    if (!params.empty()) params += ';';
+    if (kind == 0) params += background ? "49" : "39";
+    else if (kind == 1 && color < 8) params += std::to_string((background ? 40 : 30) + static_cast<int>(color));
+    else if (kind == 1 && color < 16) params += std::to_string((background ? 100 : 90) + static_cast<int>(color) - 8);
+    else if (kind == 1) params += (background ? "48;5;" : "38;5;") + std::to_string(color);
+    else {
+        params += background ? "48;2;" : "38;2;";
+        params += std::to_string((color >> 16) & 0xFF); params += ';';
+        params += std::to_string((color >> 8) & 0xFF); params += ';';
+        params += std::to_string(color & 0xFF);
     }
+}
 
-    // Extract just the first frame
-    std::string ffmpeg_cmd = "ffmpeg -i \"" + g_args.filename + "\" -vf \"" + ffmpeg_filter_complex + "\" -vframes 1 -y \"" + first_png_path.string() + "\"";
-    if (run_command_silent_ex(ffmpeg_cmd, !g_args.verbose) != 0) {
-        std::filesystem::remove_all(temp_first_frame_dir);
-        g_pipeline_error_occurred.store(true);
-        return false;
+// Emit the SGR sequence that takes the terminal from style `from` to `to`, naming only what changes.
+// Turning an attribute off, or an unknown `from`, starts the sequence from a reset instead.
+void append_style_change(std::string& out, const CellStyle* from, const CellStyle& to) {
+    const CellStyle reset;
+    if (from && *from == to) return;
+    std::string params;
+    if (!from || (from->attrs & ~to.attrs) != 0) {
+        params = "0";
+        from = &reset;
     }
+    for (size_t bit = 0; bit < sizeof(kAttrBits); ++bit) {
+        if ((to.attrs & ~from->attrs) & (1u << bit)) { params += params.empty() ? "" : ";"; params += std::to_string(kAttrBits[bit]); }
+    }
+    if (to.fg_kind != from->fg_kind || to.fg != from->fg) append_color_params(params, false, to.fg_kind, to.fg);
+    if (to.bg_kind != from->bg_kind || to.bg != from->bg) append_color_params(params, true, to.bg_kind, to.bg);
+    out += "\033[";
+    out += params;
+    out += 'm';
+}
 
-    if (!std::filesystem::exists(first_png_path)) {
-         std::lock_guard<std::mutex> lock(g_cerr_mutex);
+// Parse frame text into rows of cells. Understands SGR, REP ("\033[nb") and private mode toggles
+// such as cursor hide/show; returns false for anything else (cursor movement, wide glyphs, a REP
+// running past max_columns, ...).
+bool parse_frame_cells(std::string_view frame, int max_rows, int max_columns, std::vector<std::vector<Cell>>& rows) {
+    rows.assign(1, {});
+    CellStyle style;
+    size_t i = 0;
+    while (i < frame.size()) {
+        unsigned char ch = static_cast<unsigned char>(frame[i]);
+        if (ch == '\n') {
+            if (static_cast<int>(rows.size()) >= max_rows) return true;
+            rows.emplace_back();
+            ++i;
+            continue;
+        }
+        if (ch == '\r') { ++i; continue; }
+        if (ch == 0x1B) {
+            if (i + 1 >= frame.size() || frame[i + 1] != '[') return false;
+            size_t j = i + 2;
+            while (j < frame.size() && (static_cast<unsigned char>(frame[j]) < 0x40 || static_cast<unsigned char>(frame[j]) > 0x7E)) ++j;
+            if (j >= frame.size()) return false;
+            std::string_view params = frame.substr(i + 2, j - i - 2);
+            char final_byte = frame[j];
+            if (final_byte == 'm') {
+                apply_sgr_params(params, style);
+            } else if (final_byte == 'b') { // REP: repeat the previous glyph
+                if (rows.back().empty()) return false;
+                int count = 1;
+                if (!params.empty()) {
+                    auto result = std::from_chars(params.data(), params.data() + params.size(), count);
+                    if (result.ec != std::errc() || result.ptr != params.data() + params.size() || count < 0) return false;
+                }
+                if (count > max_columns - static_cast<int>(rows.back().size())) return false;
+                Cell repeated = rows.back().back();
+                repeated.style = style;
+                for (int k = 0; k < count; ++k) rows.back().push_back(repeated);
+            } else if (!(params.size() > 0 && params[0] == '?' && (final_byte == 'h' || final_byte == 'l'))) {
+                return false;
+            }
+            i = j + 1;
+            continue;
+        }
+        if (ch < 0x20) return false;
+        size_t len = (ch < 0x80) ? 1 : (ch >> 5) == 0x6 ? 2 : (ch >> 4) == 0xE ? 3 : (ch >> 3) == 0x1E ? 4 : 0;
+        if (len == 0 || i + len > frame.size()) return false;
+        uint32_t cp = (len == 1) ? ch : (len == 2) ? (ch & 0x1Fu) : (len == 3) ? (ch & 0x0Fu) : (ch & 0x07u);
+        for (size_t k = 1; k < len; ++k) cp = (cp << 6) | (static_cast<unsigned char>(frame[i + k]) & 0x3Fu);
+        bool wide = (cp >= 0x1100 && cp <= 0x115F) || (cp >= 0x2E80 && cp <= 0xA4CF) || (cp >= 0xAC00 && cp <= 0xD7A3) ||
+                    (cp >= 0xF900 && cp <= 0xFAFF) || (cp >= 0xFE30 && cp <= 0xFE4F) || (cp >= 0xFF00 && cp <= 0xFF60) ||
+                    (cp >= 0xFFE0 && cp <= 0xFFE6) || (cp >= 0x1F300 && cp <= 0x1FAFF) || (cp >= 0x20000 && cp <= 0x3FFFD);
+        if (wide) return false;
+        Cell cell;
+        cell.style = style;
+        std::memcpy(cell.glyph, frame.data() + i, len);
+        cell.glyph_len = static_cast<uint8_t>(len);
+        rows.back().push_back(cell);
+        i += len;
+    }
+    if (!rows.empty() && rows.back().empty() && static_cast<int>(rows.size()) > 1) rows.pop_back(); // Trailing newline
+    return true;
+}
+
+constexpr uint8_t kAttrsVisibleOnBlank = 0x08 | 0x20; // Underline, inverse
+
+inline bool is_plain_blank(const Cell& cell) {
+    return cell.glyph_len == 1 && cell.glyph[0] == ' ' && (cell.style.attrs & kAttrsVisibleOnBlank) == 0;
+}
+
+// Cells that look the same on screen compare equal: a blank's foreground colour is invisible
+inline bool cells_look_same(const Cell& a, const Cell& b) {
+    if (a == b) return true;
+    return is_plain_blank(a) && is_plain_blank(b) && a.style.bg_kind == b.style.bg_kind && a.style.bg == b.style.bg;
+}
+
+// Writes runs of cells as text. The terminal's style at the start is the default or, for a delta span
+// drawn over whatever the screen holds, unknown; finish() leaves it at the default. In between, each
+// cell names only the SGR parameters that change, and a blank keeps whatever foreground and invisible
+// attributes are current.
+class CellTextWriter {
+public:
+    CellTextWriter(std::string& out, bool starts_at_default) : out_(out), known_(starts_at_default) {}
+
+    void add(const Cell& cell) {
+        CellStyle wanted = cell.style;
+        if (is_plain_blank(cell)) {
+            const CellStyle base = known_ ? current_ : CellStyle{};
+            wanted.fg_kind = base.fg_kind;
+            wanted.fg = base.fg;
+            wanted.attrs = base.attrs & static_cast<uint8_t>(~kAttrsVisibleOnBlank);
+        }
+        append_style_change(out_, known_ ? &current_ : nullptr, wanted);
+        current_ = wanted;
+        known_ = true;
+        out_.append(cell.glyph, cell.glyph_len);
+    }
+
+    void finish() {
+        if (known_ && current_ != CellStyle{}) out_ += "\033[0m";
+        current_ = CellStyle{};
+    }
+
+private:
+    std::string& out_;
+    CellStyle current_;
+    bool known_;
+};
+
+struct DeltaOpHeader {
+    uint16_t row;
+    uint16_t col;
+    uint32_t length; // Bytes of span text following the header
+};
+
+constexpr int kDeltaMergeGap = 6; // Unchanged cells cheaper to rewrite than to jump over with a cursor move
+
+// Build the ops that turn `prev` into `cur` on screen (both padded to rows x width blank cells)
+void build_frame_delta(const std::vector<std::vector<Cell>>& prev, const std::vector<std::vector<Cell>>& cur,
+                       int rows, int width, std::string& out) {
+    out.clear();
+    const Cell blank;
+    std::string span;
+    for (int r = 0; r < rows; ++r) {
+        const std::vector<Cell>* prev_row = (static_cast<size_t>(r) < prev.size()) ? &prev[static_cast<size_t>(r)] : nullptr;
+        const std::vector<Cell>* cur_row = (static_cast<size_t>(r) < cur.size()) ? &cur[static_cast<size_t>(r)] : nullptr;
+        int prev_len = prev_row ? static_cast<int>(prev_row->size()) : width;
+        int cur_len = cur_row ? static_cast<int>(cur_row->size()) : width;
+        int cols = std::max(prev_len, cur_len);
+        auto cur_cell = [&](int c) -> const Cell& { return (cur_row && c < cur_len) ? (*cur_row)[static_cast<size_t>(c)] : blank; };
+        auto changed = [&](int c) {
+            if (prev_row && c >= prev_len) return true; // Nothing known there, always draw
+            const Cell& before = prev_row ? (*prev_row)[static_cast<size_t>(c)] : blank;
+            return !cells_look_same(before, cur_cell(c));
+        };
+
+        int c = 0;
+        while (c < cols) {
+            if (!changed(c)) { ++c; continue; }
+            int span_start = c, span_end = c + 1, gap = 0;
+            for (int k = c + 1; k < cols; ++k) {
+                if (changed(k)) { span_end = k + 1; gap = 0; }
+                else if (++gap > kDeltaMergeGap) break;
+            }
+            span.clear();
+            CellTextWriter span_writer(span, false);
+            for (int k = span_start; k < span_end; ++k) span_writer.add(cur_cell(k));
+            span_writer.finish();
+            DeltaOpHeader op{static_cast<uint16_t>(r), static_cast<uint16_t>(span_start), static_cast<uint32_t>(span.size())};
+            out.append(reinterpret_cast<const char*>(&op), sizeof(op));
+            out += span;
+            c = span_end;
+        }
+    }
+}
+
+// Frame Text Minimization
+// Converter output repeats a full truecolor sequence on nearly every cell, so a frame can be many times
+// the size of its glyphs. Every converted frame is parsed into cells and written out again by
+// CellTextWriter, with colours first quantized to --color-depth. Frames the parser doesn't understand
+// (cursor movement, wide glyphs) are kept as they are.
+enum class ColorDepth { TrueColor, Palette256, Palette16 };
+ColorDepth g_color_depth = ColorDepth::TrueColor;
+
+// xterm's default palette
+constexpr uint32_t kAnsi16Palette[16] = {
+    0x000000, 0xCD0000, 0x00CD00, 0xCDCD00, 0x0000EE, 0xCD00CD, 0x00CDCD, 0xE5E5E5,
+    0x7F7F7F, 0xFF0000, 0x00FF00, 0xFFFF00, 0x5C5CFF, 0xFF00FF, 0x00FFFF, 0xFFFFFF,
+};
+constexpr uint8_t kCubeLevels[6] = {0, 95, 135, 175, 215, 255};
+
+uint32_t palette_rgb(uint32_t index) {
+    if (index < 16) return kAnsi16Palette[index];
+    if (index < 232) {
+        const uint32_t i = index - 16;
+        return (static_cast<uint32_t>(kCubeLevels[i / 36]) << 16) | (static_cast<uint32_t>(kCubeLevels[i / 6 % 6]) << 8) | kCubeLevels[i % 6];
+    }
+    const uint32_t grey = 8 + 10 * (index - 232);
+    return (grey << 16) | (grey << 8) | grey;
+}
+
+inline int rgb_distance(uint32_t a, uint32_t b) {
+    const int dr = static_cast<int>((a >> 16) & 0xFF) - static_cast<int>((b >> 16) & 0xFF);
+    const int dg = static_cast<int>((a >> 8) & 0xFF) - static_cast<int>((b >> 8) & 0xFF);
+    const int db = static_cast<int>(a & 0xFF) - static_cast<int>(b & 0xFF);
+    return dr * dr + dg * dg + db * db;
+}
+
+// Nearest of the 6x6x6 cube and the grey ramp (indices 16-255)
+uint32_t nearest_256_color(uint32_t rgb) {
+    auto nearest_level = [](uint32_t channel) {
+        uint32_t best = 0;
+        for (uint32_t i = 1; i < 6; ++i) {
+            if (std::abs(static_cast<int>(kCubeLevels[i]) - static_cast<int>(channel)) <
+                std::abs(static_cast<int>(kCubeLevels[best]) - static_cast<int>(channel))) best = i;
+        }
+        return best;
+    };
+    const uint32_t cube = 16 + 36 * nearest_level((rgb >> 16) & 0xFF) + 6 * nearest_level((rgb >> 8) & 0xFF) + nearest_level(rgb & 0xFF);
+    const uint32_t average = (((rgb >> 16) & 0xFF) + ((rgb >> 8) & 0xFF) + (rgb & 0xFF)) / 3;
+    const uint32_t grey = 232 + std::min<uint32_t>(23, average < 8 ? 0 : (average - 8 + 5) / 10);
+    return rgb_distance(rgb, palette_rgb(grey)) < rgb_distance(rgb, palette_rgb(cube)) ? grey : cube;
+}
+
+uint32_t nearest_16_color(uint32_t rgb) {
+    uint32_t best = 0;
+    for (uint32_t i = 1; i < 16; ++i) {
+        if (rgb_distance(rgb, kAnsi16Palette[i]) < rgb_distance(rgb, kAnsi16Palette[best])) best = i;
+    }
+    return best;
+}
+
+void quantize_color(uint8_t& kind, uint32_t& color) {
+    if (g_color_depth == ColorDepth::TrueColor || kind == 0) return;
+    if (kind == 1 && (g_color_depth == ColorDepth::Palette256 || color < 16)) return;
+    const uint32_t rgb = (kind == 2) ? color : palette_rgb(color);
+    kind = 1;
+    color = (g_color_depth == ColorDepth::Palette256) ? nearest_256_color(rgb) : nearest_16_color(rgb);
+}
+
+// Rewrite a converted frame in place; false if it was left as it is
+bool minimize_frame_text(std::string& text) {
+    if (text.find('\033') == std::string::npos && g_color_depth == ColorDepth::TrueColor) return false; // Nothing to shorten
+    thread_local std::vector<std::vector<Cell>> rows;
+    if (!parse_frame_cells(text, INT32_MAX, g_args.width, rows)) return false;
+    std::string minimized;
+    minimized.reserve(text.size() / 2);
+    CellTextWriter writer(minimized, true); // Like converter output, each line starts and ends in the default style
+    for (size_t r = 0; r < rows.size(); ++r) {
+        if (r > 0) minimized += '\n';
+        for (Cell& cell : rows[r]) {
+            quantize_color(cell.style.fg_kind, cell.style.fg);
+            quantize_color(cell.style.bg_kind, cell.style.bg);
+            writer.add(cell);
+        }
+        writer.finish();
+    }
+    if (!text.empty() && text.back() == '\n') minimized += '\n';
+    if (minimized.size() >= text.size() && g_color_depth == ColorDepth::TrueColor) return false;
+    stat_record(StatId::FrameTextSaved, text.size() > minimized.size() ? text.size() - minimized.size() : 0);
+    text.swap(minimized);
+    return true;
+}
+
+// Frame Compression
+// A small LZ77 codec in the LZ4 block layout for frame texts. A frame is long runs of the same few SGR
+// sequences and glyphs, which 4-byte matches in a 64 KiB window capture well (a run is a match at
+// offset 1), and decoding is a plain copy loop. Frames are compressed one by one so any frame can be
+// decoded on its own.
+// Sequence: token (literal count << 4 | match length - 4, each nibble extended by 255-runs when 15),
+// literals, 16-bit little-endian match offset. The last sequence is literals only.
+constexpr size_t kLzMinMatch = 4;
+constexpr size_t kLzMaxOffset = 65535;
+constexpr int kLzHashBits = 13;
+
+inline uint32_t lz_read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline uint32_t lz_hash(uint32_t v) { return (v * 2654435761u) >> (32 - kLzHashBits); }
+
+void lz_append_length(std::string& out, size_t len) {
+    while (len >= 255) {
+        out.push_back(static_cast<char>(255));
+        len -= 255;
+    }
+    out.push_back(static_cast<char>(len));
+}
+
+void lz_compress(std::string_view in, std::string& out) {
+    out.clear();
+    const char* const base = in.data();
+    const size_t n = in.size();
+    std::vector<uint32_t> table(size_t{1} << kLzHashBits, 0); // Position + 1 of the last 4 bytes with this hash
+
+    auto emit = [&](size_t literal_begin, size_t literal_len, size_t offset, size_t match_len) {
+        const size_t match_code = match_len ? match_len - kLzMinMatch : 0;
+        out.push_back(static_cast<char>((std::min<size_t>(literal_len, 15) << 4) | std::min<size_t>(match_code, 15)));
+        if (literal_len >= 15) lz_append_length(out, literal_len - 15);
+        out.append(base + literal_begin, literal_len);
+        if (match_len == 0) return;
+        out.push_back(static_cast<char>(offset & 0xff));
+        out.push_back(static_cast<char>(offset >> 8));
+        if (match_code >= 15) lz_append_length(out, match_code - 15);
+    };
+
+    size_t anchor = 0, pos = 0;
+    while (pos + kLzMinMatch <= n) {
+        const uint32_t seq = lz_read32(base + pos);
+        uint32_t& slot = table[lz_hash(seq)];
+        const size_t candidate = slot;
+        slot = static_cast<uint32_t>(pos + 1);
+        if (candidate == 0 || pos - (candidate - 1) > kLzMaxOffset || lz_read32(base + candidate - 1) != seq) {
+            pos++;
+            continue;
+        }
+        const size_t match_pos = candidate - 1;
+        size_t match_len = kLzMinMatch;
+        while (pos + match_len < n && base[match_pos + match_len] == base[pos + match_len]) match_len++;
+        emit(anchor, pos - anchor, pos - match_pos, match_len);
+        pos += match_len;
+        anchor = pos;
+        if (pos + kLzMinMatch <= n) table[lz_hash(lz_read32(base + pos - 2))] = static_cast<uint32_t>(pos - 1);
+    }
+    emit(anchor, n - anchor, 0, 0);
+}
+
+// Decode into exactly dst_size bytes. Every length and offset is checked, so a damaged pack fails
+// here instead of reading or writing out of bounds.
+bool lz_decompress(std::string_view in, char* dst, size_t dst_size) {
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(in.data());
+    const unsigned char* const end = src + in.size();
+    size_t out = 0;
+    auto read_length = [&](size_t& len) {
+        unsigned char b;
+        do {
+            if (src == end) return false;
+            b = *src++;
+            len += b;
+        } while (b == 255);
+        return true;
+    };
+    while (src < end) {
+        const unsigned char token = *src++;
+        size_t literal_len = token >> 4;
+        if (literal_len == 15 && !read_length(literal_len)) return false;
+        if (literal_len > static_cast<size_t>(end - src) || literal_len > dst_size - out) return false;
+        std::memcpy(dst + out, src, literal_len);
+        src += literal_len;
+        out += literal_len;
+        if (src == end) break; // Last sequence
+        if (end - src < 2) return false;
+        const size_t offset = static_cast<size_t>(src[0]) | (static_cast<size_t>(src[1]) << 8);
+        src += 2;
+        size_t match_len = token & 15;
+        if (match_len == 15 && !read_length(match_len)) return false;
+        match_len += kLzMinMatch;
+        if (offset == 0 || offset > out || match_len > dst_size - out) return false;
+        const char* from = dst + out - offset;
+        if (offset >= match_len) {
+            std::memcpy(dst + out, from, match_len);
+        } else {
+            for (size_t k = 0; k < match_len; ++k) dst[out + k] = from[k]; // Overlapping: repeats the last `offset` bytes
+        }
+        out += match_len;
+    }
+    return out == dst_size;
+}
+
+
+// Frame Pack
+// All ASCII frames of a render live in one frame pack: a fixed header, an index of
+// (offset, length) entries and the frame texts back to back, followed by the same layout
+// for the per-frame deltas. Identical frames share one copy of their text, and frame texts are
+// stored LZ-compressed (a 32-bit decoded length, then the compressed bytes) whenever that is
+// smaller. The player maps it read-only, so a warm start costs one open and one mmap regardless
+// of the frame count, and every player of the same clip shares the compressed pages.
+constexpr char kFramePackMagic[8] = {'A', 'N', 'I', 'P', 'A', 'C', 'K', '\0'};
+constexpr uint32_t kFramePackVersion = 5;
+constexpr uint32_t kDeltaFullRedraw = 1; // Delta index flag: redrawing the whole frame is cheaper
+constexpr uint32_t kFrameCompressed = 2; // Frame index flag: the text is an LZ block
+
+struct FramePackHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t frame_count;
+    uint32_t rows;                 // Text rows per frame (the actual Chafa height)
+    uint32_t width;                // Columns per frame
+    uint64_t index_offset;         // From start of file
+    uint64_t payload_offset;       // From start of file
+    uint64_t payload_size;
+    uint64_t delta_index_offset;   // From start of file
+    uint64_t delta_payload_offset; // From start of file
+    uint64_t delta_payload_size;
+    uint64_t max_frame_length;     // Longest frame text; a larger decoded length marks a damaged block
+};
+
+struct FramePackIndexEntry {
+    uint64_t offset; // From payload_offset (or delta_payload_offset)
+    uint32_t length;
+    uint32_t flags;
+};
+
+// Pack every .txt frame in frames_dir (in name order) into pack_path, along with the delta from
+// each frame's predecessor (frame 0 against the last frame, for looping). `rows` and `width` are
+// the drawn animation area. Written to a temp file and renamed into place so a reader never sees
+// a half-written pack. Returns the packed frame count, -1 on error.
+int write_frame_pack(const std::filesystem::path& pack_path, const std::filesystem::path& frames_dir, int rows, int width) {
+    ScopedStatTimer stat_timer(StatId::FramePackWrite);
+    std::vector<std::filesystem::path> frame_paths;
+    for (const auto& entry : std::filesystem::directory_iterator(frames_dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".txt") frame_paths.push_back(entry.path());
+    }
+    std::sort(frame_paths.begin(), frame_paths.end());
+
+    std::vector<FramePackIndexEntry> index(frame_paths.size());
+    std::string payload;
+    std::unordered_map<uint64_t, size_t> frame_by_hash; // Content hash -> first frame with that text
+    size_t unique_frames = 0;
+    size_t max_frame_length = 0;
+    for (size_t i = 0; i < frame_paths.size(); ++i) {
+        std::ifstream frame_input_stream(frame_paths[i], std::ios::binary);
+        if (!frame_input_stream.is_open()) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "ERROR: Could not read frame for packing: " << frame_paths[i] << '\n';
+            return -1;
+        }
+        std::string frame_data_str((std::istreambuf_iterator<char>(frame_input_stream)), std::istreambuf_iterator<char>());
+        auto inserted = frame_by_hash.emplace(xxhash64(frame_data_str.data(), frame_data_str.size()), i);
+        if (!inserted.second) {
+            const FramePackIndexEntry& earlier = index[inserted.first->second];
+            if (std::string_view(payload.data() + earlier.offset, earlier.length) == frame_data_str) {
+                index[i] = earlier; // Held or repeated frame: point at the existing text
+                continue;
+            }
+        }
+        index[i] = {payload.size(), static_cast<uint32_t>(frame_data_str.size()), 0};
+        max_frame_length = std::max(max_frame_length, frame_data_str.size());
+        payload += frame_data_str;
+        unique_frames++;
+    }
+
+    std::vector<FramePackIndexEntry> delta_index(index.size());
+    std::string delta_payload;
+    std::vector<std::vector<Cell>> first_cells, prev_cells, cur_cells;
+    bool first_parsed = false, prev_parsed = false;
+    std::string delta;
+    size_t full_redraws = 0;
+    auto add_delta = [&](size_t i, bool parsed_pair, const std::vector<std::vector<Cell>>& before, const std::vector<std::vector<Cell>>& after) {
+        if (parsed_pair) build_frame_delta(before, after, rows, width, delta);
+        if (!parsed_pair || delta.size() >= index[i].length) {
+            delta_index[i] = {delta_payload.size(), 0, kDeltaFullRedraw};
+            full_redraws++;
+            return;
+        }
+        delta_index[i] = {delta_payload.size(), static_cast<uint32_t>(delta.size()), 0};
+        delta_payload += delta;
+    };
+    for (size_t i = 0; i < index.size(); ++i) {
+        std::string_view frame(payload.data() + index[i].offset, index[i].length);
+        bool cur_parsed = parse_frame_cells(frame, rows, width, cur_cells);
+        if (i == 0) {
+            first_cells = cur_cells;
+            first_parsed = cur_parsed;
+        } else {
+            add_delta(i, prev_parsed && cur_parsed, prev_cells, cur_cells);
+        }
+        std::swap(prev_cells, cur_cells);
+        prev_parsed = cur_parsed;
+    }
+    if (!index.empty()) add_delta(0, prev_parsed && first_parsed, prev_cells, first_cells); // Loop wrap-around
+
+    // Deltas are built from the plain texts; what goes into the pack is each text's smaller encoding
+    std::vector<FramePackIndexEntry> stored_index(index.size());
+    std::string stored_payload;
+    std::map<std::pair<uint64_t, uint32_t>, size_t> stored_by_text; // Shared texts are encoded once
+    std::string compressed;
+    for (size_t i = 0; i < index.size(); ++i) {
+        auto inserted = stored_by_text.emplace(std::make_pair(index[i].offset, index[i].length), i);
+        if (!inserted.second) {
+            stored_index[i] = stored_index[inserted.first->second];
+            continue;
+        }
+        std::string_view frame(payload.data() + index[i].offset, index[i].length);
+        lz_compress(frame, compressed);
+        if (sizeof(uint32_t) + compressed.size() < frame.size()) {
+            const uint32_t raw_length = index[i].length;
+            stored_index[i] = {stored_payload.size(), static_cast<uint32_t>(sizeof(raw_length) + compressed.size()), kFrameCompressed};
+            stored_payload.append(reinterpret_cast<const char*>(&raw_length), sizeof(raw_length));
+            stored_payload += compressed;
+        } else {
+            stored_index[i] = {stored_payload.size(), index[i].length, 0};
+            stored_payload += frame;
+        }
+    }
+    stored_payload.resize((stored_payload.size() + 7) & ~size_t{7}, '\0'); // Keep the delta index 8-byte aligned
+
+    FramePackHeader header{};
+    std::memcpy(header.magic, kFramePackMagic, sizeof(header.magic));
+    header.version = kFramePackVersion;
+    header.frame_count = static_cast<uint32_t>(index.size());
+    header.rows = static_cast<uint32_t>(std::max(0, rows));
+    header.width = static_cast<uint32_t>(std::max(0, width));
+    header.index_offset = sizeof(FramePackHeader);
+    header.payload_offset = header.index_offset + index.size() * sizeof(FramePackIndexEntry);
+    header.payload_size = stored_payload.size();
+    header.delta_index_offset = header.payload_offset + header.payload_size;
+    header.delta_payload_offset = header.delta_index_offset + delta_index.size() * sizeof(FramePackIndexEntry);
+    header.delta_payload_size = delta_payload.size();
+    header.max_frame_length = max_frame_length;
+
+    std::filesystem::path temp_path = pack_path;
+    temp_path += ".tmp";
+    {
+        std::ofstream pack_stream(temp_path, std::ios::binary | std::ios::trunc);
+        pack_stream.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        pack_stream.write(reinterpret_cast<const char*>(stored_index.data()), static_cast<std::streamsize>(stored_index.size() * sizeof(FramePackIndexEntry)));
+        pack_stream.write(stored_payload.data(), static_cast<std::streamsize>(stored_payload.size()));
+        pack_stream.write(reinterpret_cast<const char*>(delta_index.data()), static_cast<std::streamsize>(delta_index.size() * sizeof(FramePackIndexEntry)));
+        pack_stream.write(delta_payload.data(), static_cast<std::streamsize>(delta_payload.size()));
+        if (!pack_stream) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "ERROR: Failed to write frame pack: " << temp_path << '\n';
+            return -1;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, pack_path, ec);
+    if (ec) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ERROR: Failed to move frame pack into place: " << ec.message() << '\n';
+        return -1;
+    }
+    print_verbose("Packed " + std::to_string(index.size()) + " frames (" + std::to_string(unique_frames) + " unique, " +
+                  std::to_string(payload.size()) + " bytes, " + std::to_string(stored_payload.size()) + " stored, deltas " +
+                  std::to_string(delta_payload.size()) + " bytes, " + std::to_string(full_redraws) + " full redraws) into " + pack_path.string());
+    return static_cast<int>(index.size());
+}
+
+// Read-only memory mapping of a frame pack
+class FramePack {
+public:
+    FramePack() = default;
+    FramePack(const FramePack&) = delete;
+    FramePack& operator=(const FramePack&) = delete;
+    ~FramePack() { close(); }
+
+    bool open(const std::filesystem::path& pack_path) {
+        close();
+        int fd = ::open(pack_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(FramePackHeader)) { ::close(fd); return false; }
+        void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd); // The mapping keeps the file referenced
+        if (mapping == MAP_FAILED) return false;
+        base_ = static_cast<const char*>(mapping);
+        size_ = static_cast<size_t>(st.st_size);
+        file_identity_ = {static_cast<uint64_t>(st.st_dev), static_cast<uint64_t>(st.st_ino),
+                          static_cast<uint64_t>(st.st_mtim.tv_sec), static_cast<uint64_t>(st.st_mtim.tv_nsec), size_};
+
+        std::memcpy(&header_, base_, sizeof(header_));
+        // Every bound is checked by subtraction, so damaged offsets can't wrap around into range
+        const uint64_t index_bytes = static_cast<uint64_t>(header_.frame_count) * sizeof(FramePackIndexEntry);
+        auto section_valid = [&](uint64_t index_offset, uint64_t payload_offset, uint64_t payload_size) {
+            return index_offset % alignof(FramePackIndexEntry) == 0 && payload_offset <= size_ && index_offset <= payload_offset &&
+                   index_bytes <= payload_offset - index_offset && payload_size <= size_ - payload_offset;
+        };
+        const bool valid = std::memcmp(header_.magic, kFramePackMagic, sizeof(kFramePackMagic)) == 0 &&
+                           header_.version == kFramePackVersion &&
+                           section_valid(header_.index_offset, header_.payload_offset, header_.payload_size) &&
+                           section_valid(header_.delta_index_offset, header_.delta_payload_offset, header_.delta_payload_size) &&
+                           // An LZ block decodes to at most 255 bytes per stored byte
+                           header_.max_frame_length <= UINT32_MAX && header_.max_frame_length / 255 <= header_.payload_size;
+        if (!valid) {
+            print_verbose("Frame pack failed validation: " + pack_path.string());
+            close();
+            return false;
+        }
+        // Index entries are checked as frames are read, so opening costs the same for any clip length.
+        // Start reading both indexes in the background; frame pages are read ahead by the player.
+        index_ = reinterpret_cast<const FramePackIndexEntry*>(base_ + header_.index_offset);
+        delta_index_ = reinterpret_cast<const FramePackIndexEntry*>(base_ + header_.delta_index_offset);
+        advise_range(header_.index_offset, static_cast<uint64_t>(header_.frame_count) * sizeof(FramePackIndexEntry), MADV_WILLNEED);
+        advise_range(header_.delta_index_offset, static_cast<uint64_t>(header_.frame_count) * sizeof(FramePackIndexEntry), MADV_WILLNEED);
+        return true;
+    }
+
+    void close() {
+        if (base_) munmap(const_cast<char*>(base_), size_);
+        base_ = nullptr;
+        size_ = 0;
+        index_ = nullptr;
+        delta_index_ = nullptr;
+        file_identity_ = {};
+        header_ = FramePackHeader{};
+    }
+
+    size_t frame_count() const { return base_ ? header_.frame_count : 0; }
+    int rows() const { return static_cast<int>(header_.rows); }
+    uint64_t payload_size() const { return header_.payload_size; }
+    uint64_t header_checksum() const { return xxhash64(&header_, sizeof(header_)); }
+    // Tells this pack file apart from any other, including an earlier render at the same path
+    uint64_t identity() const { return xxhash64(file_identity_.data(), sizeof(file_identity_), header_checksum()); }
+    // Where frame i's stored text starts; frames with the same text share it
+    uint64_t stored_offset(size_t i) const { return index_[i].offset; }
+
+    // Decoded length of frame i's text (0 if its index entry or stored length is damaged)
+    size_t frame_size(size_t i) const {
+        if (!frame_entry_valid(i)) return 0;
+        if ((index_[i].flags & kFrameCompressed) == 0) return index_[i].length;
+        uint32_t raw_length;
+        std::memcpy(&raw_length, base_ + header_.payload_offset + index_[i].offset, sizeof(raw_length));
+        return raw_length <= header_.max_frame_length ? raw_length : 0;
+    }
+
+    // Decode frame i's text into out; false if its compressed block is damaged
+    bool decode_frame(size_t i, std::string& out) const {
+        if (!frame_entry_valid(i)) return false;
+        const char* stored = base_ + header_.payload_offset + index_[i].offset;
+        if ((index_[i].flags & kFrameCompressed) == 0) {
+            out.assign(stored, index_[i].length);
+            return true;
+        }
+        const size_t raw_length = frame_size(i);
+        if (raw_length == 0) return false; // Only texts that shrink are compressed, so never an empty one
+        out.resize(raw_length);
+        return lz_decompress(std::string_view(stored + sizeof(uint32_t), index_[i].length - sizeof(uint32_t)), &out[0], out.size());
+    }
+
+    // Delta ops turning frame i-1 (or the last frame, for i == 0) into frame i
+    bool has_delta(size_t i) const { return delta_entry_valid(i) && (delta_index_[i].flags & kDeltaFullRedraw) == 0; }
+    std::string_view delta(size_t i) const {
+        return std::string_view(base_ + header_.delta_payload_offset + delta_index_[i].offset, delta_index_[i].length);
+    }
+
+    // Pass an madvise hint for the pages holding frame i's stored text and delta. MADV_DONTNEED only
+    // hands whole pages back, so a neighbour sharing a page with frame i stays mapped.
+    void advise_frame(size_t i, int advice) const {
+        if (frame_entry_valid(i)) advise_range(header_.payload_offset + index_[i].offset, index_[i].length, advice);
+        if (delta_entry_valid(i)) advise_range(header_.delta_payload_offset + delta_index_[i].offset, delta_index_[i].length, advice);
+    }
+
+private:
+    static bool entry_within(const FramePackIndexEntry& entry, uint64_t region_size) {
+        return entry.offset <= region_size && entry.length <= region_size - entry.offset;
+    }
+    bool frame_entry_valid(size_t i) const {
+        return entry_within(index_[i], header_.payload_size) &&
+               ((index_[i].flags & kFrameCompressed) == 0 || index_[i].length >= sizeof(uint32_t));
+    }
+    bool delta_entry_valid(size_t i) const { return entry_within(delta_index_[i], header_.delta_payload_size); }
+
+    void advise_range(uint64_t offset, uint64_t length, int advice) const {
+        static const uint64_t page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+        if (length == 0) return;
+        uint64_t begin = offset & ~(page_size - 1);
+        uint64_t end = std::min<uint64_t>((offset + length + page_size - 1) & ~(page_size - 1), size_);
+        if (advice == MADV_DONTNEED) {
+            begin = (offset + page_size - 1) & ~(page_size - 1);
+            end = (offset + length) & ~(page_size - 1);
+        }
+        if (begin < end) madvise(const_cast<char*>(base_) + begin, end - begin, advice);
+    }
+
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    std::array<uint64_t, 5> file_identity_{}; // Device, inode, modification time and size
+    FramePackHeader header_{};
+    const FramePackIndexEntry* index_ = nullptr;
+    const FramePackIndexEntry* delta_index_ = nullptr;
+};
+
+// Frame count recorded in a pack header, or -1 if the pack is missing or invalid
+int read_frame_pack_count(const std::filesystem::path& pack_path) {
+    FramePack pack;
+    if (!pack.open(pack_path)) return -1;
+    return static_cast<int>(pack.frame_count());
+}
+
+// Shared Frame Texts
+// When the whole clip's decoded text fits in --memory-budget, it is decoded once into a file in
+// $XDG_RUNTIME_DIR (or /dev/shm) that every instance playing the same pack maps read-only, so N
+// instances hold one copy of the frames in RAM instead of N. The instance whose O_EXCL create makes
+// the file fills it under an exclusive flock() while the others wait for a shared lock; every user
+// then holds a shared lock, and whoever finds itself the last user on the way out removes the file.
+// Only a regular file of this user's with mode 0600 is ever mapped, so nobody else can put text on
+// the terminal. A complete file left behind by a crash is picked up by the next instance playing that
+// pack; those of other packs that nobody holds are removed when an instance attaches.
+constexpr char kSharedTextsMagic[8] = {'A', 'N', 'I', 'F', 'S', 'H', 'M', '1'};
+constexpr int kSharedTextsAttempts = 50;           // Then this instance decodes its own frames
+constexpr double kSharedTextsCreateGraceSeconds = 1.0; // A younger file nobody has locked may still be about to be filled
+
+struct SharedTextsHeader {
+    char magic[8];
+    uint64_t pack_identity;
+    uint32_t frame_count;
+    uint32_t complete;  // Written last, once every frame is in place
+    uint64_t text_size; // Bytes of text after the index
+};
+
+struct SharedTextsEntry {
+    uint64_t offset; // From the end of the index
+    uint64_t length;
+};
+
+class SharedFrameTexts {
+public:
+    SharedFrameTexts() = default;
+    SharedFrameTexts(const SharedFrameTexts&) = delete;
+    SharedFrameTexts& operator=(const SharedFrameTexts&) = delete;
+
+    // Map the decoded texts of pack, filling the shared file first if no instance has. False when the
+    // texts don't fit in budget_bytes or there's no shared memory to put them in.
+    bool attach(const FramePack& pack, size_t budget_bytes) {
+        detach();
+        const size_t n = pack.frame_count();
+        if (n == 0) return false;
+        std::unordered_map<uint64_t, size_t> stored_texts; // Frames sharing a stored text share it here too
+        uint64_t text_size = 0;
+        for (size_t i = 0; i < n; ++i) {
+            if (stored_texts.emplace(pack.stored_offset(i), i).second) text_size += pack.frame_size(i);
+        }
+        if (text_size > budget_bytes) return false;
+
+        const uint64_t identity = pack.identity();
+        const std::string prefix = file_prefix();
+        path_ = prefix + hash_to_hex(identity);
+        remove_unused_files(prefix, path_);
+        const size_t mapping_size = sizeof(SharedTextsHeader) + n * sizeof(SharedTextsEntry) + text_size;
+        bool ready = false;
+        // Whoever creates the file fills it. The others wait for a shared lock, which the filler's
+        // exclusive lock holds off until it is done, and never keep one while waiting for anything else.
+        for (int attempt = 0; attempt < kSharedTextsAttempts && !ready; ++attempt) {
+            fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+            if (fd_ >= 0) {
+                if (fchmod(fd_, 0600) != 0 || flock(fd_, LOCK_EX) != 0) break;
+                ready = fill(pack, stored_texts, identity, mapping_size) && map(mapping_size) && valid(identity, n);
+                flock(fd_, LOCK_SH); // Other instances may map it now
+                break;
+            }
+            if (errno != EEXIST) break;
+            fd_ = ::open(path_.c_str(), O_RDWR | O_NOFOLLOW | O_CLOEXEC);
+            struct stat st;
+            if (fd_ >= 0 && !private_file(fd_, st)) {
+                print_verbose("Shared frame texts " + path_ + " are not a private file of this user's; decoding here instead.");
+                ::close(fd_); // Not ours to remove either
+                fd_ = -1;
+            }
+            if (fd_ < 0) break;
+            while (flock(fd_, LOCK_SH) != 0) {
+                if (errno != EINTR) { detach(); return false; }
+            }
+            ready = fstat(fd_, &st) == 0 && static_cast<size_t>(st.st_size) == mapping_size && map(mapping_size) && valid(identity, n);
+            if (ready) break;
+            // Left incomplete by a filler that died: remove it once nobody else is looking, and create it again
+            unmap();
+            flock(fd_, LOCK_UN);
+            if (flock(fd_, LOCK_EX | LOCK_NB) == 0 && seconds_since_modified(st) >= kSharedTextsCreateGraceSeconds) unlink(path_.c_str());
+            ::close(fd_);
+            fd_ = -1;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        if (!ready) {
+            detach();
+            return false;
+        }
+        entries_ = reinterpret_cast<const SharedTextsEntry*>(base_ + sizeof(SharedTextsHeader));
+        texts_ = base_ + sizeof(SharedTextsHeader) + n * sizeof(SharedTextsEntry);
+        frame_count_ = n;
+        return true;
+    }
+
+    bool is_open() const { return base_ != nullptr; }
+
+    std::string_view frame(size_t i) const {
+        if (i >= frame_count_) return {};
+        return std::string_view(texts_ + entries_[i].offset, entries_[i].length);
+    }
+
+    // Remove the shared file if no other instance uses it. Safe at exit: the mapping stays in place.
+    void release() {
+        if (fd_ < 0) return;
+        if (flock(fd_, LOCK_EX | LOCK_NB) == 0) {
+            unlink(path_.c_str());
+            print_verbose("Removed shared frame texts " + path_ + "; no other instance uses them.");
+        }
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    void detach() {
+        release();
+        unmap();
+        frame_count_ = 0;
+    }
+
+private:
+    // $XDG_RUNTIME_DIR is private to this user; /dev/shm is shared, so names there carry the uid
+    static std::string file_prefix() {
+        const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+        if (runtime_dir && runtime_dir[0] == '/') return std::string(runtime_dir) + "/anifetch-texts-";
+        return "/dev/shm/anifetch-" + std::to_string(getuid()) + "-";
+    }
+
+    // A regular file of this user's that nobody else can read or write
+    static bool private_file(int fd, struct stat& st) {
+        return fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_uid == getuid() && (st.st_mode & 07777) == 0600;
+    }
+
+    static double seconds_since_modified(const struct stat& st) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        return static_cast<double>(now.tv_sec - st.st_mtim.tv_sec) + (now.tv_nsec - st.st_mtim.tv_nsec) / 1e9;
+    }
+
+    // Remove the files of other packs that no instance holds: left by a crash, or by a pack since rendered again
+    static void remove_unused_files(const std::string& prefix, const std::string& keep) {
+        const std::filesystem::path prefix_path(prefix);
+        const std::string name_prefix = prefix_path.filename().string();
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(prefix_path.parent_path(), ec)) {
+            const std::string path = entry.path().string();
+            if (path == keep || entry.path().filename().string().rfind(name_prefix, 0) != 0) continue;
+            int fd = ::open(path.c_str(), O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_CLOEXEC);
+            if (fd < 0) continue;
+            struct stat st;
+            if (private_file(fd, st) && seconds_since_modified(st) >= kSharedTextsCreateGraceSeconds && flock(fd, LOCK_EX | LOCK_NB) == 0) {
+                unlink(path.c_str());
+                print_verbose("Removed unused shared frame texts " + path);
+            }
+            ::close(fd);
+        }
+    }
+
+    bool map(size_t size) {
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) return false;
+        base_ = static_cast<const char*>(mapping);
+        size_ = size;
+        return true;
+    }
+
+    void unmap() {
+        if (base_) munmap(const_cast<char*>(base_), size_);
+        base_ = nullptr;
+        size_ = 0;
+    }
+
+    bool valid(uint64_t identity, size_t n) const {
+        SharedTextsHeader header;
+        std::memcpy(&header, base_, sizeof(header));
+        if (std::memcmp(header.magic, kSharedTextsMagic, sizeof(kSharedTextsMagic)) != 0 || header.pack_identity != identity ||
+            header.frame_count != n || !header.complete) return false;
+        const uint64_t index_end = sizeof(SharedTextsHeader) + n * sizeof(SharedTextsEntry);
+        if (index_end + header.text_size != size_) return false;
+        const SharedTextsEntry* entries = reinterpret_cast<const SharedTextsEntry*>(base_ + sizeof(SharedTextsHeader));
+        for (size_t i = 0; i < n; ++i) {
+            if (entries[i].offset > header.text_size || entries[i].length > header.text_size - entries[i].offset) return false;
+        }
+        return true;
+    }
+
+    bool fill(const FramePack& pack, const std::unordered_map<uint64_t, size_t>& stored_texts, uint64_t identity, size_t size) {
+        ScopedStatTimer stat_timer(StatId::SharedTextsFill);
+        if (ftruncate(fd_, 0) != 0 || ftruncate(fd_, static_cast<off_t>(size)) != 0) return false;
+        void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (mapping == MAP_FAILED) return false;
+        char* base = static_cast<char*>(mapping);
+        const size_t n = pack.frame_count();
+        SharedTextsEntry* entries = reinterpret_cast<SharedTextsEntry*>(base + sizeof(SharedTextsHeader));
+        char* texts = base + sizeof(SharedTextsHeader) + n * sizeof(SharedTextsEntry);
+        uint64_t text_size = 0;
+        std::string text;
+        bool ok = true;
+        for (size_t i = 0; i < n && ok; ++i) {
+            const size_t first_user = stored_texts.at(pack.stored_offset(i));
+            if (first_user != i) {
+                entries[i] = entries[first_user];
+                continue;
+            }
+            if (!pack.decode_frame(i, text)) text.clear(); // Shown blank, as DecodedFrameCache would
+            ok = text_size + text.size() <= size - (texts - base);
+            if (!ok) break;
+            std::memcpy(texts + text_size, text.data(), text.size());
+            entries[i] = {text_size, text.size()};
+            text_size += text.size();
+        }
+        SharedTextsHeader header{};
+        std::memcpy(header.magic, kSharedTextsMagic, sizeof(header.magic));
+        header.pack_identity = identity;
+        header.frame_count = static_cast<uint32_t>(n);
+        header.complete = ok ? 1 : 0;
+        header.text_size = size - static_cast<size_t>(texts - base); // A damaged frame leaves its room unused
+        std::memcpy(base, &header, sizeof(header));
+        munmap(mapping, size);
+        return ok;
+    }
+
+    std::string path_;
+    int fd_ = -1;
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    const SharedTextsEntry* entries_ = nullptr;
+    const char* texts_ = nullptr;
+    size_t frame_count_ = 0;
+};
+
+SharedFrameTexts g_shared_frame_texts; // Texts of the pack being played, when they are shared
+
+// Decoded Frame Cache
+// Playback keeps only part of a compressed pack decoded. A decoder thread works ahead of the play
+// position through the frames that will need their full text (those without a usable delta, or every
+// frame with --full-redraw) while the decoded total fits in --memory-budget, evicting the frames it
+// will need last. The next few needed frames are always decoded, whatever the budget.
+// The same thread reads the pack ahead: it asks the kernel for the pages of the next frames before
+// playback touches them, so a cold page cache or a slow home directory never stalls a frame, and
+// unless --retain-frames is given it hands the pages of played frames back.
+class DecodedFrameCache {
+public:
+    using Text = std::shared_ptr<const std::string>;
+
+    DecodedFrameCache() = default;
+    DecodedFrameCache(const DecodedFrameCache&) = delete;
+    DecodedFrameCache& operator=(const DecodedFrameCache&) = delete;
+    ~DecodedFrameCache() { stop(); }
+
+    // With texts_shared, frame texts come from g_shared_frame_texts and only the read-ahead runs
+    void start(const FramePack& pack, size_t budget_bytes, bool full_redraw, bool retain_pages, bool texts_shared) {
+        stop();
+        pack_ = &pack;
+        budget_ = budget_bytes;
+        full_redraw_ = full_redraw;
+        texts_shared_ = texts_shared;
+        retain_pages_ = retain_pages;
+        position_ = 0;
+        read_ahead_position_ = pack.frame_count(); // Nothing read ahead yet
+        needed_.clear();
+        for (size_t i = 0; i < pack.frame_count(); ++i) {
+            if (needs_text(i)) needed_.push_back(i);
+        }
+        stopping_ = false;
+        decoder_ = std::thread([this] { run(); });
+    }
+
+    void stop() {
+        if (!decoder_.joinable()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        cv_.notify_one();
+        decoder_.join();
+        frames_.clear();
+        resident_ = 0;
+        pack_ = nullptr;
+    }
+
+    // Tell the decoder which frame is on screen now
+    void advance(size_t slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (slot == position_) return;
+            position_ = slot;
+        }
+        cv_.notify_one();
+    }
+
+    // Full text of a frame; decoded on the spot if the decoder has not got to it yet
+    Text frame(size_t slot) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            auto it = frames_.find(slot);
+            if (it != frames_.end()) return it->second;
+        }
+        stat_record(StatId::FrameDecodeStalls, 1);
+        Text text = decode(slot);
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (make_room(text->size(), 0)) insert(slot, text);
+        return text;
+    }
+
+    size_t resident_bytes() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return resident_;
+    }
+
+private:
+    static constexpr size_t kAlwaysAhead = 4; // Needed frames kept decoded even past the budget
+    static constexpr size_t kReadAheadFrames = 32;
+    static constexpr size_t kDecodeAheadFrames = 32; // Needed frames looked at past the one on screen
+
+    bool needs_text(size_t slot) const { return !texts_shared_ && (full_redraw_ || !pack_->has_delta(slot)); }
+
+    size_t distance_ahead(size_t slot) const {
+        const size_t n = pack_->frame_count();
+        return (slot + n - position_) % n;
+    }
+
+    Text decode(size_t slot) const {
+        ScopedStatTimer stat_timer(StatId::FrameDecode);
+        auto text = std::make_shared<std::string>();
+        if (!pack_->decode_frame(slot, *text)) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "Warning: Frame " << slot << " in the frame pack is damaged; showing it blank. Try --force-render.\n";
+            text->clear();
+        }
+        return text;
+    }
+
+    void insert(size_t slot, const Text& text) {
+        if (frames_.emplace(slot, text).second) resident_ += text->size();
+    }
+
+    // Evict frames needed later than `keep_within` frames from now until `incoming` more bytes fit
+    bool make_room(size_t incoming, size_t keep_within) {
+        while (resident_ + incoming > budget_) {
+            auto victim = frames_.end();
+            size_t victim_distance = keep_within;
+            for (auto it = frames_.begin(); it != frames_.end(); ++it) {
+                size_t d = distance_ahead(it->first);
+                if (d > victim_distance) {
+                    victim = it;
+                    victim_distance = d;
+                }
+            }
+            if (victim == frames_.end()) return false;
+            resident_ -= victim->second->size();
+            frames_.erase(victim);
+        }
+        return true;
+    }
+
+    // Advise the frames entering the read-ahead window since the last call, and release the ones played
+    void read_ahead(size_t from, size_t to) const {
+        const size_t n = pack_->frame_count();
+        const size_t window = std::min(kReadAheadFrames, n);
+        size_t moved = from == n ? window : (to + n - from) % n;
+        if (moved == 0) return;
+        if (moved > window) moved = window;
+        for (size_t k = window - moved; k < window; ++k) pack_->advise_frame((to + k) % n, MADV_WILLNEED);
+        if (retain_pages_ || from == n) return;
+        for (size_t k = 0; k < moved; ++k) {
+            size_t played = (to + n - moved + k) % n;
+            if ((played + n - to) % n >= window) pack_->advise_frame(played, MADV_DONTNEED); // Not coming round again yet
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!stopping_) {
+            const size_t n = pack_->frame_count();
+            if (read_ahead_position_ != position_) {
+                const size_t from = read_ahead_position_, to = position_;
+                read_ahead_position_ = to;
+                lock.unlock();
+                read_ahead(from, to);
+                lock.lock();
+                continue;
+            }
+            size_t next = n;
+            if (!needed_.empty()) {
+                const size_t first = static_cast<size_t>(std::lower_bound(needed_.begin(), needed_.end(), position_) - needed_.begin());
+                const size_t window = std::min(kDecodeAheadFrames, needed_.size());
+                for (size_t k = 0; k < window; ++k) {
+                    const size_t slot = needed_[(first + k) % needed_.size()];
+                    if (frames_.count(slot)) continue;
+                    if (!make_room(pack_->frame_size(slot), distance_ahead(slot)) && k >= kAlwaysAhead) break;
+                    next = slot;
+                    break;
+                }
+            }
+            if (next == n) {
+                cv_.wait(lock);
+                continue;
+            }
+            lock.unlock();
+            Text text = decode(next);
+            lock.lock();
+            insert(next, text);
+        }
+    }
+
+    const FramePack* pack_ = nullptr;
+    size_t budget_ = 0;
+    bool full_redraw_ = false;
+    bool retain_pages_ = false;
+    bool texts_shared_ = false;
+    size_t position_ = 0;
+    size_t read_ahead_position_ = 0;
+    bool stopping_ = false;
+    size_t resident_ = 0;
+    std::vector<size_t> needed_; // Slots drawn from their full text, in order; fixed while the pack is open
+    std::unordered_map<size_t, Text> frames_;
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::thread decoder_;
+};
+
+
+// Decoded Frame Tier
+// With --decode-cache, stream-mode frames are decoded once per (video, framerate, chroma key, width
+// bucket) into .cache/decoded/<key>.frames, and renders at any size or symbol set within the bucket
+// read their pixels from there instead of running FFmpeg. Each frame is stored losslessly as the
+// byte-wise difference from the frame before it (a keyframe stores the pixels themselves), LZ-compressed
+// when that is smaller: static regions become zero runs that cost almost nothing.
+constexpr char kDecodeTierMagic[8] = {'A', 'N', 'I', 'D', 'E', 'C', 'O', 'D'};
+constexpr uint32_t kDecodeTierVersion = 1;
+constexpr int kDecodeTierKeyframeInterval = 30;
+constexpr uint32_t kTierKeyframe = 1;   // Block flag: pixels, not a difference
+constexpr uint32_t kTierCompressed = 2; // Block flag: LZ block
+
+struct DecodeTierHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t frame_count;
+    uint32_t width;
+    uint32_t height;
+    uint32_t channels;
+    uint32_t reserved;
+    uint64_t index_offset; // From start of file; the blocks sit between the header and the index
+};
+
+struct DecodeTierIndexEntry {
+    uint64_t offset; // From start of file
+    uint32_t length;
+    uint32_t flags;
+};
+
+// Apply one stored block to `frame`, which holds the previous frame unless the block is a keyframe
+bool apply_tier_block(std::string_view block, uint32_t flags, unsigned char* frame, size_t frame_bytes, std::string& scratch) {
+    if (flags & kTierCompressed) {
+        scratch.resize(frame_bytes);
+        if (!lz_decompress(block, &scratch[0], frame_bytes)) return false;
+        block = scratch;
+    }
+    if (block.size() != frame_bytes) return false;
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(block.data());
+    if (flags & kTierKeyframe) {
+        std::memcpy(frame, src, frame_bytes);
+    } else {
+        for (size_t i = 0; i < frame_bytes; ++i) frame[i] = static_cast<unsigned char>(frame[i] + src[i]);
+    }
+    return true;
+}
+
+// Builds a tier alongside a full FFmpeg decode. Each decode segment appends its frames to its own part
+// file; finish() joins the parts in frame order once every frame is there.
+class DecodeTierWriter {
+public:
+    bool active() const { return !segments_.empty(); }
+
+    void begin(const std::filesystem::path& tier_path, int width, int height, int channels, size_t segment_count) {
+        abandon();
+        tier_path_ = tier_path;
+        width_ = width;
+        height_ = height;
+        channels_ = channels;
+        segments_.resize(segment_count);
+        for (size_t i = 0; i < segment_count; ++i) segments_[i].path = part_path(i);
+    }
+
+    // Called only by the decode task of `segment`, with the frame's pixels
+    void add_frame(size_t segment_index, int frame_number, const unsigned char* pixels) {
+        Segment& segment = segments_[segment_index];
+        const size_t frame_bytes = static_cast<size_t>(width_) * height_ * channels_;
+        if (!segment.out.is_open()) segment.out.open(segment.path, std::ios::binary | std::ios::trunc);
+        const bool keyframe = segment.previous.empty() || segment.blocks.size() % kDecodeTierKeyframeInterval == 0;
+        segment.residual.resize(frame_bytes);
+        if (keyframe) {
+            std::memcpy(&segment.residual[0], pixels, frame_bytes);
+        } else {
+            for (size_t i = 0; i < frame_bytes; ++i) segment.residual[i] = static_cast<char>(pixels[i] - segment.previous[i]);
+        }
+        segment.previous.assign(pixels, pixels + frame_bytes);
+
+        lz_compress(segment.residual, segment.compressed);
+        const bool compressed = segment.compressed.size() < frame_bytes;
+        const std::string& stored = compressed ? segment.compressed : segment.residual;
+        Block block;
+        block.frame_number = frame_number;
+        block.offset = segment.written;
+        block.length = static_cast<uint32_t>(stored.size());
+        block.flags = (keyframe ? kTierKeyframe : 0) | (compressed ? kTierCompressed : 0);
+        segment.out.write(stored.data(), static_cast<std::streamsize>(stored.size()));
+        segment.written += stored.size();
+        segment.blocks.push_back(block);
+    }
+
+    // Join the parts into the tier. A segment may run past the first frame of the next one
+    // (segment_base_frames[i + 1]); those frames belong to the next segment. Gives up, leaving no
+    // tier, unless frames 1..N are all present.
+    bool finish(const std::vector<int>& segment_base_frames) {
+        std::vector<std::pair<size_t, size_t>> order; // (segment, block) in frame order
+        bool parts_written = true;
+        for (size_t i = 0; i < segments_.size(); ++i) {
+            if (segments_[i].out.is_open()) {
+                segments_[i].out.close();
+                parts_written = parts_written && !segments_[i].out.fail();
+            }
+            const int owned_until = i + 1 < segment_base_frames.size() ? segment_base_frames[i + 1] : INT32_MAX;
+            for (size_t b = 0; b < segments_[i].blocks.size(); ++b) {
+                if (segments_[i].blocks[b].frame_number <= owned_until) order.push_back({i, b});
+            }
+        }
+        bool complete = parts_written && !order.empty();
+        for (size_t k = 0; complete && k < order.size(); ++k) {
+            complete = segments_[order[k].first].blocks[order[k].second].frame_number == static_cast<int>(k + 1);
+        }
+        if (!complete) {
+            print_verbose("Decode cache: frames are missing, not writing " + tier_path_.string());
+            abandon();
+            return false;
+        }
+
+        std::filesystem::path temp_path = tier_path_;
+        temp_path += ".tmp";
+        std::ofstream tier(temp_path, std::ios::binary | std::ios::trunc);
+        DecodeTierHeader header{};
+        std::memcpy(header.magic, kDecodeTierMagic, sizeof(header.magic));
+        header.version = kDecodeTierVersion;
+        header.frame_count = static_cast<uint32_t>(order.size());
+        header.width = static_cast<uint32_t>(width_);
+        header.height = static_cast<uint32_t>(height_);
+        header.channels = static_cast<uint32_t>(channels_);
+        tier.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        std::vector<DecodeTierIndexEntry> index;
+        index.reserve(order.size());
+        uint64_t offset = sizeof(header);
+        std::string block_data;
+        for (size_t i = 0; i < segments_.size() && tier; ++i) {
+            std::ifstream part(segments_[i].path, std::ios::binary);
+            for (const auto& entry : order) {
+                if (entry.first != i) continue;
+                const Block& block = segments_[i].blocks[entry.second];
+                block_data.resize(block.length);
+                part.seekg(static_cast<std::streamoff>(block.offset));
+                part.read(&block_data[0], static_cast<std::streamsize>(block.length));
+                if (!part) tier.setstate(std::ios::failbit);
+                tier.write(block_data.data(), static_cast<std::streamsize>(block_data.size()));
+                index.push_back({offset, block.length, block.flags});
+                offset += block.length;
+            }
+        }
+        header.index_offset = offset;
+        tier.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size() * sizeof(DecodeTierIndexEntry)));
+        tier.seekp(0);
+        tier.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        tier.close();
+        std::error_code ec;
+        if (tier) std::filesystem::rename(temp_path, tier_path_, ec);
+        if (!tier || ec) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "Warning: Could not write the decode cache " << tier_path_ << '\n';
+            std::filesystem::remove(temp_path, ec);
+            abandon();
+            return false;
+        }
+        print_verbose("Decode cache: wrote " + std::to_string(order.size()) + " frames (" + std::to_string(offset) + " bytes) to " + tier_path_.string());
+        abandon(); // Only the part files are left to remove
+        return true;
+    }
+
+    void abandon() {
+        std::error_code ec;
+        for (auto& segment : segments_) {
+            segment.out.close();
+            std::filesystem::remove(segment.path, ec);
+        }
+        segments_.clear();
+    }
+
+    // Part files left behind by a build that was killed mid-decode
+    static void remove_stale_parts(const std::filesystem::path& tier_path) {
+        const std::string prefix = tier_path.filename().string() + ".part";
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(tier_path.parent_path(), ec)) {
+            if (entry.path().filename().string().rfind(prefix, 0) == 0) std::filesystem::remove(entry.path(), ec);
+        }
+    }
+
+private:
+    struct Block {
+        int frame_number;
+        uint64_t offset; // In the part file
+        uint32_t length;
+        uint32_t flags;
+    };
+    struct Segment {
+        std::filesystem::path path;
+        std::ofstream out;
+        uint64_t written = 0;
+        std::vector<Block> blocks;
+        std::vector<unsigned char> previous;
+        std::string residual, compressed;
+    };
+
+    std::filesystem::path part_path(size_t segment_index) const {
+        std::filesystem::path path = tier_path_;
+        path += ".part" + std::to_string(segment_index);
+        return path;
+    }
+
+    std::filesystem::path tier_path_;
+    int width_ = 0, height_ = 0, channels_ = 0;
+    std::vector<Segment> segments_;
+};
+
+// Read-only memory mapping of a finished tier
+class DecodeTier {
+public:
+    DecodeTier() = default;
+    DecodeTier(const DecodeTier&) = delete;
+    DecodeTier& operator=(const DecodeTier&) = delete;
+    ~DecodeTier() { close(); }
+
+    bool open(const std::filesystem::path& tier_path, int channels) {
+        close();
+        int fd = ::open(tier_path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(DecodeTierHeader)) { ::close(fd); return false; }
+        void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) return false;
+        base_ = static_cast<const char*>(mapping);
+        size_ = static_cast<size_t>(st.st_size);
+        std::memcpy(&header_, base_, sizeof(header_));
+        bool valid = std::memcmp(header_.magic, kDecodeTierMagic, sizeof(kDecodeTierMagic)) == 0 &&
+                     header_.version == kDecodeTierVersion && header_.frame_count > 0 &&
+                     header_.width > 0 && header_.height > 0 && header_.channels == static_cast<uint32_t>(channels) &&
+                     header_.index_offset <= size_ &&
+                     static_cast<uint64_t>(header_.frame_count) * sizeof(DecodeTierIndexEntry) <= size_ - header_.index_offset;
+        if (valid) {
+            index_ = reinterpret_cast<const DecodeTierIndexEntry*>(base_ + header_.index_offset);
+            valid = (index_[0].flags & kTierKeyframe) != 0;
+        }
+        if (!valid) {
+            print_verbose("Decode cache failed validation: " + tier_path.string());
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        if (base_) munmap(const_cast<char*>(base_), size_);
+        base_ = nullptr;
+        size_ = 0;
+        index_ = nullptr;
+        header_ = DecodeTierHeader{};
+    }
+
+    bool is_open() const { return base_ != nullptr; }
+    int frame_count() const { return static_cast<int>(header_.frame_count); }
+    int width() const { return static_cast<int>(header_.width); }
+    int height() const { return static_cast<int>(header_.height); }
+    size_t frame_bytes() const { return static_cast<size_t>(header_.width) * header_.height * header_.channels; }
+
+    // Frames are numbered from 1. The nearest keyframe at or before frame_number, to start decoding from.
+    int keyframe_for(int frame_number) const {
+        int k = frame_number;
+        while (k > 1 && (index_[k - 1].flags & kTierKeyframe) == 0) --k;
+        return k;
+    }
+
+    // Advance `frame` (holding frame_number - 1, unless frame_number is a keyframe) to frame_number
+    bool decode(int frame_number, unsigned char* frame, std::string& scratch) const {
+        const DecodeTierIndexEntry& entry = index_[frame_number - 1];
+        if (entry.offset > header_.index_offset || entry.length > header_.index_offset - entry.offset) return false;
+        return apply_tier_block(std::string_view(base_ + entry.offset, entry.length), entry.flags, frame, frame_bytes(), scratch);
+    }
+
+private:
+    const char* base_ = nullptr;
+    size_t size_ = 0;
+    DecodeTierHeader header_{};
+    const DecodeTierIndexEntry* index_ = nullptr;
+};
+
+DecodeTierWriter g_decode_tier_writer;
+DecodeTier g_decode_tier;
+std::filesystem::path g_decode_tier_path;
+bool g_decode_tier_written = false; // This run wrote the tier, so even --force-render reads it back
+
+
+// Map audio codec name to common file extension
+std::string get_ext_from_codec(const std::string& codec) {
+    static const std::map<std::string, std::string> codec_extension_map = {
+        {"aac", "m4a"}, {"mp3", "mp3"}, {"opus", "opus"}, {"vorbis", "ogg"},
+        {"pcm_s16le", "wav"}, {"flac", "flac"}, {"alac", "m4a"}
+    };
+    auto it = codec_extension_map.find(codec);
+    return (it != codec_extension_map.end()) ? it->second : "bin"; // Default
+}
+
+// Use ffprobe to check audio codec of a file
+std::string check_codec_of_file(const std::string& file_path) {
+    ScopedStatTimer stat_timer(StatId::FfprobeCall);
+    std::string result = run_command_with_output_ex({"ffprobe", "-v", "error", "-select_streams", "a:0", "-show_entries", "stream=codec_name",
+                                                     "-of", "default=nokey=1:noprint_wrappers=1", file_path});
+    if (!result.empty() && result.back() == '\n') result.pop_back(); // Trim newline
+    return result;
+}
+
+// Extract audio stream from video file using ffmpeg
+std::string extract_audio_from_file(const std::string& input_file, const std::string& extension, const std::filesystem::path& dest_dir) {
+    ScopedStatTimer stat_timer(StatId::AudioExtract);
+    std::filesystem::path audio_file_path = dest_dir / ("output_audio." + extension);
+    const std::vector<std::string> cmd = {"ffmpeg", "-i", input_file, "-y", "-vn", "-c:a", "copy", "-loglevel", "error", audio_file_path.string()};
+    print_verbose("Extracting audio: " + describe_command(cmd));
+    SubprocessOptions options;
+    options.quiet = !g_args.verbose;
+    int exit_code = run_subprocess(cmd, options);
+    if (exit_code > 0) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ffmpeg audio extraction failed (exit code " << exit_code << ").\n";
+        return "";
+    } else if (exit_code < 0) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ffmpeg audio extraction did not exit normally.\n";
+        return "";
+    }
+    return audio_file_path.string();
+}
+
+// Get video duration using ffprobe
+double get_video_duration_ex(const std::string& filename) {
+    ScopedStatTimer stat_timer(StatId::FfprobeCall);
+    print_verbose("Probing video duration for: " + filename);
+    std::string output = run_command_with_output_ex({"ffprobe", "-v", "error", "-show_entries", "format=duration",
+                                                     "-of", "default=noprint_wrappers=1:nokey=1", filename});
+    try {
+        if (!output.empty()) return std::stod(output);
+    } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ERROR: Failed to parse video duration from ffprobe output '" << output << "'. Error: " << e.what() << '\n';
+    }
+    return 0.0; // Indicate failure
+}
+
+// Build the FFmpeg video filter chain shared by every frame extraction.
+// A non-zero scale_width/scale_height additionally resizes frames to that exact pixel size.
+std::string build_video_filter(int scale_width, int scale_height) {
+    std::string filter = "fps=" + std::to_string(g_args.framerate);
+    if (g_args.chroma_flag_given) {
+        filter += ",format=rgba,colorkey=" + g_args.chroma_arg + ":similarity=0.01:blend=0";
+    } else {
+        filter += ",format=rgb24"; // Default format
+    }
+    if (scale_width > 0 && scale_height > 0) {
+        filter += ",scale=" + std::to_string(scale_width) + ":" + std::to_string(scale_height) + ":flags=area";
+    }
+    return filter;
+}
+
+// Get the pixel dimensions of the first video stream using ffprobe
+bool probe_video_dimensions(const std::string& filename, int& width, int& height) {
+    ScopedStatTimer stat_timer(StatId::FfprobeCall);
+    std::string output = run_command_with_output_ex({"ffprobe", "-v", "error", "-select_streams", "v:0", "-show_entries", "stream=width,height",
+                                                     "-of", "csv=p=0:s=x", filename});
+    if (sscanf(output.c_str(), "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ERROR: Failed to parse video dimensions from ffprobe output '" << output << "'.\n";
+        return false;
+    }
+    return true;
+}
+
+// Keyframe times of the first video stream in seconds from the first keyframe, read from the packet
+// index (demuxing only, nothing is decoded). Empty if ffprobe reports none or doesn't finish: a
+// partial list would look complete to the planner.
+std::vector<double> probe_keyframe_times(const std::string& filename) {
+    ScopedStatTimer stat_timer(StatId::FfprobeCall);
+    std::string probe_output;
+    if (!run_command_with_output_ex({"ffprobe", "-v", "error", "-select_streams", "v:0", "-show_entries", "packet=pts_time,flags",
+                                     "-of", "csv=p=0", filename}, probe_output)) {
+        print_verbose("Keyframe probe failed; segment cuts stay on the frame grid.");
+        return {};
+    }
+    std::istringstream output(probe_output);
+    std::vector<double> times;
+    std::string line;
+    while (std::getline(output, line)) {
+        size_t comma = line.find(',');
+        if (comma == std::string::npos || line.find('K', comma) == std::string::npos) continue;
+        char* end = nullptr;
+        double pts = std::strtod(line.c_str(), &end);
+        if (end != line.c_str() && std::isfinite(pts)) times.push_back(pts); // "N/A" doesn't parse
+    }
+    std::sort(times.begin(), times.end());
+    if (!times.empty()) {
+        const double origin = times.front();
+        for (double& t : times) t -= origin;
+    }
+    return times;
+}
+
+// Pick the pixel size FFmpeg scales frames to in stream mode.
+// Chafa samples at most 8 pixels per cell horizontally, so anything wider is wasted pipe bandwidth.
+void compute_stream_frame_size(int video_width, int video_height, int& out_width, int& out_height) {
+    out_width = std::min(video_width, std::max(1, g_args.width * 8));
+    out_height = std::max(1, static_cast<int>(std::lround(static_cast<double>(video_height) * out_width / video_width)));
+}
+
+// Encode raw RGB/RGBA pixels as a PNG with stored (uncompressed) deflate blocks.
+// Much cheaper than a real PNG encode; the file only lives until Chafa has read it.
+void encode_png_uncompressed(const unsigned char* pixels, int width, int height, int channels, std::string& out) {
+    static const std::vector<uint32_t> crc_table = [] {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }();
+    auto put_u32 = [&out](uint32_t v) {
+        out.push_back(static_cast<char>(v >> 24)); out.push_back(static_cast<char>(v >> 16));
+        out.push_back(static_cast<char>(v >> 8)); out.push_back(static_cast<char>(v));
+    };
+    auto write_chunk = [&](size_t data_start) {
+        // Chunk data has already been appended at data_start; patch in length, append CRC
+        uint32_t len = static_cast<uint32_t>(out.size() - data_start);
+        for (int i = 0; i < 4; ++i) out[data_start - 8 + i] = static_cast<char>(len >> (24 - 8 * i));
+        uint32_t crc = 0xFFFFFFFFu;
+        for (size_t i = data_start - 4; i < out.size(); ++i) crc = crc_table[(crc ^ static_cast<unsigned char>(out[i])) & 0xFF] ^ (crc >> 8);
+        put_u32(crc ^ 0xFFFFFFFFu);
+    };
+    auto adler_update = [](uint32_t& a, uint32_t& b, const unsigned char* data, size_t len) {
+        while (len > 0) {
+            size_t n = std::min<size_t>(len, 5552); // Largest run that cannot overflow before the modulo
+            len -= n;
+            while (n--) { a += *data++; b += a; }
+            a %= 65521; b %= 65521;
+        }
+    };
+    auto begin_chunk = [&](const char* type) {
+        put_u32(0); // Length placeholder
+        out.append(type, 4);
+        return out.size();
+    };
+
+    const size_t row_bytes = static_cast<size_t>(width) * channels;
+    const size_t raw_size = (row_bytes + 1) * height; // Each scanline is prefixed with filter type 0
+    out.clear();
+    out.reserve(raw_size + raw_size / 65535 * 5 + 128);
+    out.append("\x89PNG\r\n\x1a\n", 8);
+
+    size_t start = begin_chunk("IHDR");
+    put_u32(static_cast<uint32_t>(width));
+    put_u32(static_cast<uint32_t>(height));
+    out.push_back(8);                                  // Bit depth
+    out.push_back(static_cast<char>(channels == 4 ? 6 : 2)); // Colour type: RGBA or RGB
+    out.append(3, '\0');                               // Compression, filter, interlace
+    write_chunk(start);
+
+    start = begin_chunk("IDAT");
+    out.push_back(0x78); out.push_back(0x01); // zlib header, no compression
+    uint32_t adler_a = 1, adler_b = 0;
+    size_t remaining = raw_size;
+    size_t row = 0, col = 0; // Position within the virtual filtered scanline stream
+    while (remaining > 0) {
+        uint16_t block_len = static_cast<uint16_t>(std::min<size_t>(remaining, 65535));
+        remaining -= block_len;
+        out.push_back(remaining == 0 ? 1 : 0); // BFINAL flag, BTYPE=00 (stored)
+        out.push_back(static_cast<char>(block_len & 0xFF)); out.push_back(static_cast<char>(block_len >> 8));
+        out.push_back(static_cast<char>(~block_len & 0xFF)); out.push_back(static_cast<char>((~block_len >> 8) & 0xFF));
+        size_t left_in_block = block_len;
+        while (left_in_block > 0) {
+            if (col == 0) { // Scanline filter byte
+                out.push_back(0);
+                adler_b = (adler_b + adler_a) % 65521;
+                col = 1; --left_in_block;
+                continue;
+            }
+            size_t take = std::min(left_in_block, row_bytes - (col - 1));
+            const unsigned char* src = pixels + row * row_bytes + (col - 1);
+            out.append(reinterpret_cast<const char*>(src), take);
+            adler_update(adler_a, adler_b, src, take);
+            col += take; left_in_block -= take;
+            if (col - 1 == row_bytes) { col = 0; ++row; }
+        }
+    }
+    put_u32((adler_b << 16) | adler_a);
+    write_chunk(start);
+
+    start = begin_chunk("IEND");
+    write_chunk(start);
+}
+
+// Native Renderer
+// In-process replacement for Chafa covering the common symbol sets, so stream mode does not
+// have to spawn a process per frame. Cells are area-averaged from the raw frame and mapped
+// to glyphs by luminance.
+
+enum class NativeSymbols { Ascii, Shade, HalfBlock };
+
+struct NativeRenderStyle {
+    NativeSymbols symbols = NativeSymbols::Ascii;
+    bool colors = true; // Emit truecolor SGR sequences
+};
+
+NativeRenderStyle g_native_style;
+std::vector<std::string> g_chafa_argument_words; // --chafa-arguments split into words
+int g_native_cols = 0; // Cell grid produced by the native renderer
+int g_native_rows = 0;
+
+constexpr char kAsciiGlyphRamp[] = " .:-=+*#%@";
+constexpr const char* kShadeGlyphRamp[] = {" ", "░", "▒", "▓", "█"};
+constexpr const char* kUpperHalfBlock = "▀";
+
+// Luminance -> ramp index lookup, built at compile time
+template <size_t RampSize>
+constexpr std::array<uint8_t, 256> make_luma_to_glyph_table() {
+    std::array<uint8_t, 256> table{};
+    for (size_t luma = 0; luma < 256; ++luma) table[luma] = static_cast<uint8_t>(luma * RampSize / 256);
+    return table;
+}
+constexpr auto kAsciiLumaTable = make_luma_to_glyph_table<sizeof(kAsciiGlyphRamp) - 1>();
+constexpr auto kShadeLumaTable = make_luma_to_glyph_table<sizeof(kShadeGlyphRamp) / sizeof(kShadeGlyphRamp[0])>();
+
+// Map --chafa-arguments onto a native style. Returns false for anything the native renderer can't reproduce.
+bool parse_native_render_style(const std::string& chafa_arguments, NativeRenderStyle& style) {
+    std::istringstream tokens_stream(chafa_arguments);
+    std::vector<std::string> tokens;
+    std::string token;
+    while (tokens_stream >> token) {
+        size_t eq = token.find('=');
+        if (token.rfind("--", 0) == 0 && eq != std::string::npos) { // Accept --opt=value as well as --opt value
+            tokens.push_back(token.substr(0, eq));
+            tokens.push_back(token.substr(eq + 1));
+        } else {
+            tokens.push_back(token);
+        }
+    }
+    std::string symbols = "block"; // Chafa's default symbol class
+    bool fg_only = false;
+    style.colors = true;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (tokens[i] == "--fg-only") fg_only = true;
+        else if (tokens[i] == "--symbols" && i + 1 < tokens.size()) symbols = tokens[++i];
+        else if ((tokens[i] == "--colors" || tokens[i] == "-c") && i + 1 < tokens.size()) {
+            const std::string& mode = tokens[++i];
+            if (mode == "none") style.colors = false;
+            else if (mode != "full") return false;
+        } else return false;
+    }
+    if (symbols == "ascii" && fg_only) style.symbols = NativeSymbols::Ascii;
+    else if (symbols == "block" && fg_only) style.symbols = NativeSymbols::Shade;
+    else if ((symbols == "block" || symbols == "half") && !fg_only) style.symbols = NativeSymbols::HalfBlock;
+    else return false;
+    return true;
+}
+
+// Fit the image into the requested cell box the way Chafa does, assuming cells are twice as tall as wide
+void compute_native_grid(int frame_width, int frame_height, int max_cols, int max_rows, int& cols, int& rows) {
+    cols = max_cols;
+    rows = static_cast<int>(std::lround(static_cast<double>(frame_height) * max_cols / frame_width / 2.0));
+    if (rows > max_rows) {
+        rows = max_rows;
+        cols = static_cast<int>(std::lround(static_cast<double>(frame_width) * max_rows * 2.0 / frame_height));
+    }
+    cols = std::max(1, std::min(cols, max_cols));
+    rows = std::max(1, std::min(rows, max_rows));
+}
+
+// acc[i] += row[i] over one band of pixel rows. The hot loop of the renderer, so it gets SIMD versions.
+void accumulate_row_scalar(uint32_t* acc, const unsigned char* row, size_t n) {
+    for (size_t i = 0; i < n; ++i) acc[i] += row[i];
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ANIFETCH_X86_SIMD 1
+__attribute__((target("sse2")))
+void accumulate_row_sse2(uint32_t* acc, const unsigned char* row, size_t n) {
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+        __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+        __m128i* a = reinterpret_cast<__m128i*>(acc + i);
+        _mm_storeu_si128(a + 0, _mm_add_epi32(_mm_loadu_si128(a + 0), _mm_unpacklo_epi16(lo16, zero)));
+        _mm_storeu_si128(a + 1, _mm_add_epi32(_mm_loadu_si128(a + 1), _mm_unpackhi_epi16(lo16, zero)));
+        _mm_storeu_si128(a + 2, _mm_add_epi32(_mm_loadu_si128(a + 2), _mm_unpacklo_epi16(hi16, zero)));
+        _mm_storeu_si128(a + 3, _mm_add_epi32(_mm_loadu_si128(a + 3), _mm_unpackhi_epi16(hi16, zero)));
+    }
+    accumulate_row_scalar(acc + i, row + i, n - i);
+}
+
+__attribute__((target("avx2")))
+void accumulate_row_avx2(uint32_t* acc, const unsigned char* row, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i));
+        __m256i* a = reinterpret_cast<__m256i*>(acc + i);
+        _mm256_storeu_si256(a + 0, _mm256_add_epi32(_mm256_loadu_si256(a + 0), _mm256_cvtepu8_epi32(bytes)));
+        _mm256_storeu_si256(a + 1, _mm256_add_epi32(_mm256_loadu_si256(a + 1), _mm256_cvtepu8_epi32(_mm_srli_si128(bytes, 8))));
+    }
+    accumulate_row_scalar(acc + i, row + i, n - i);
+}
+#endif
+
+using AccumulateRowFn = void (*)(uint32_t*, const unsigned char*, size_t);
+
+AccumulateRowFn select_accumulate_row_kernel() {
+#ifdef ANIFETCH_X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return accumulate_row_avx2;
+    if (__builtin_cpu_supports("sse2")) return accumulate_row_sse2;
+#endif
+    return accumulate_row_scalar;
+}
+
+const AccumulateRowFn g_accumulate_row = select_accumulate_row_kernel();
+
+struct CellColor { uint8_t r, g, b; bool opaque; };
+
+// Area-average one band of pixel rows [y0, y1) into `cols` cells
+void average_cell_band(const unsigned char* pixels, int width, int channels, int y0, int y1, int cols,
+                       std::vector<uint32_t>& acc, std::vector<CellColor>& out) {
+    const size_t row_bytes = static_cast<size_t>(width) * channels;
+    acc.assign(row_bytes, 0);
+    for (int y = y0; y < y1; ++y) g_accumulate_row(acc.data(), pixels + static_cast<size_t>(y) * row_bytes, row_bytes);
+
+    out.resize(static_cast<size_t>(cols));
+    const uint32_t band_rows = static_cast<uint32_t>(std::max(1, y1 - y0));
+    for (int cx = 0; cx < cols; ++cx) {
+        int x0 = static_cast<int>(static_cast<int64_t>(cx) * width / cols);
+        int x1 = std::max(x0 + 1, static_cast<int>(static_cast<int64_t>(cx + 1) * width / cols));
+        uint32_t sum[4] = {0, 0, 0, 0};
+        for (int x = x0; x < x1; ++x) {
+            const uint32_t* px = acc.data() + static_cast<size_t>(x) * channels;
+            for (int c = 0; c < channels; ++c) sum[c] += px[c];
+        }
+        uint32_t count = band_rows * static_cast<uint32_t>(x1 - x0);
+        CellColor& cell = out[static_cast<size_t>(cx)];
+        if (channels == 4) {
+            // Keyed-out pixels were zeroed, so divide by opaque coverage rather than pixel count
+            uint32_t opaque_count = sum[3] / 255;
+            cell.opaque = sum[3] >= count * 128;
+            uint32_t divisor = std::max<uint32_t>(1, opaque_count);
+            cell.r = static_cast<uint8_t>(std::min<uint32_t>(255, sum[0] / divisor));
+            cell.g = static_cast<uint8_t>(std::min<uint32_t>(255, sum[1] / divisor));
+            cell.b = static_cast<uint8_t>(std::min<uint32_t>(255, sum[2] / divisor));
+        } else {
+            cell.opaque = true;
+            cell.r = static_cast<uint8_t>(sum[0] / count);
+            cell.g = static_cast<uint8_t>(sum[1] / count);
+            cell.b = static_cast<uint8_t>(sum[2] / count);
+        }
+    }
+}
+
+inline uint8_t cell_luma(const CellColor& c) {
+    return static_cast<uint8_t>((54u * c.r + 183u * c.g + 19u * c.b) >> 8); // Rec. 709 weights
+}
+
+void append_sgr_color(std::string& out, bool background, const CellColor& c) {
+    out += background ? "\033[48;2;" : "\033[38;2;";
+    out += std::to_string(c.r); out += ';';
+    out += std::to_string(c.g); out += ';';
+    out += std::to_string(c.b); out += 'm';
+}
+
+// Render one raw frame (RGB24 or RGBA) to the same kind of text Chafa emits with --format symbols
+void render_frame_native(unsigned char* pixels, int width, int height, int channels, std::string& out) {
+    thread_local std::vector<uint32_t> acc;
+    thread_local std::vector<CellColor> top, bottom;
+    if (channels == 4) { // Zero keyed-out pixels so they don't tint the cell average
+        const size_t pixel_count = static_cast<size_t>(width) * height;
+        for (size_t i = 0; i < pixel_count; ++i) {
+            unsigned char* px = pixels + i * 4;
+            if (px[3] == 0) px[0] = px[1] = px[2] = 0;
+        }
+    }
+
+    const int cols = g_native_cols, rows = g_native_rows;
+    const bool half = (g_native_style.symbols == NativeSymbols::HalfBlock);
+    const int bands = half ? rows * 2 : rows;
+    out.clear();
+    out.reserve(static_cast<size_t>(cols) * rows * (g_native_style.colors ? 24 : 3));
+
+    for (int row = 0; row < rows; ++row) {
+        int band = half ? row * 2 : row;
+        int y0 = static_cast<int>(static_cast<int64_t>(band) * height / bands);
+        int y1 = std::max(y0 + 1, static_cast<int>(static_cast<int64_t>(band + 1) * height / bands));
+        average_cell_band(pixels, width, channels, y0, std::min(y1, height), cols, acc, top);
+        if (half) {
+            int y2 = std::max(y1 + 1, static_cast<int>(static_cast<int64_t>(band + 2) * height / bands));
+            average_cell_band(pixels, width, channels, std::min(y1, height - 1), std::min(y2, height), cols, acc, bottom);
+        }
+
+        bool have_color = false;
+        CellColor last_fg{0, 0, 0, false}, last_bg{0, 0, 0, false};
+        for (int cx = 0; cx < cols; ++cx) {
+            const CellColor& fg = top[static_cast<size_t>(cx)];
+            if (half) {
+                const CellColor& bg = bottom[static_cast<size_t>(cx)];
+                if (!fg.opaque && !bg.opaque) { // Fully keyed out: leave the terminal background showing
+                    if (have_color) out += "\033[0m";
+                    have_color = false;
+                    out += ' ';
+                    continue;
+                }
+                if (g_native_style.colors) {
+                    if (!have_color || fg.r != last_fg.r || fg.g != last_fg.g || fg.b != last_fg.b) append_sgr_color(out, false, fg);
+                    if (!have_color || bg.r != last_bg.r || bg.g != last_bg.g || bg.b != last_bg.b) append_sgr_color(out, true, bg);
+                    last_fg = fg; last_bg = bg; have_color = true;
+                    out += kUpperHalfBlock;
+                } else {
+                    out += kShadeGlyphRamp[kShadeLumaTable[(cell_luma(fg) + cell_luma(bg)) / 2]];
+                }
+                continue;
+            }
+            if (!fg.opaque) { out += ' '; continue; }
+            uint8_t luma = cell_luma(fg);
+            size_t glyph_index = (g_native_style.symbols == NativeSymbols::Ascii) ? kAsciiLumaTable[luma] : kShadeLumaTable[luma];
+            if (glyph_index == 0) { out += ' '; continue; } // Blank glyph, its colour would be invisible
+            if (g_native_style.colors && (!have_color || fg.r != last_fg.r || fg.g != last_fg.g || fg.b != last_fg.b)) {
+                append_sgr_color(out, false, fg);
+                last_fg = fg; have_color = true;
+            }
+            if (g_native_style.symbols == NativeSymbols::Ascii) out += kAsciiGlyphRamp[glyph_index];
+            else out += kShadeGlyphRamp[glyph_index];
+        }
+        if (have_color) out += "\033[0m";
+        out += '\n';
+    }
+}
+
+// Chafa command line converting `image` (a path, or "-" for stdin) to g_args.width x height cells
+std::vector<std::string> chafa_command(int height, const std::string& image) {
+    std::vector<std::string> argv = {"chafa"};
+    argv.insert(argv.end(), g_chafa_argument_words.begin(), g_chafa_argument_words.end());
+    argv.insert(argv.end(), {"--format", "symbols", "--size=" + std::to_string(g_args.width) + "x" + std::to_string(height), image});
+    return argv;
+}
+
+// Determine actual Chafa output height by processing one frame
+bool predetermine_actual_chafa_height() {
+    ScopedStatTimer stat_timer(StatId::PredetermineHeight);
+    if (g_pipeline_error_occurred.load()) return false;
+    if (g_args.renderer == "native") { // Grid follows directly from the frame size, no Chafa run needed
+        compute_native_grid(g_stream_frame_width, g_stream_frame_height, g_args.width, g_args.height_arg, g_native_cols, g_native_rows);
+        g_args.actual_chafa_height = g_native_rows;
+        print_verbose("Native renderer grid: " + std::to_string(g_native_cols) + "x" + std::to_string(g_native_rows));
+        return true;
+    }
+    print_verbose("Predetermining actual Chafa height...");
+    std::filesystem::path temp_first_frame_dir = g_render_staging_path / "temp_first_frame_extract_for_height";
+    std::filesystem::create_directories(temp_first_frame_dir);
+
+    std::ostringstream first_frame_oss;
+    first_frame_oss << std::setfill('0') << std::setw(9) << 1 << ".png";
+    std::filesystem::path first_png_path = temp_first_frame_dir / first_frame_oss.str();
+
+    if (g_decode_tier.is_open()) { // The decode cache already has the first frame
+        std::vector<unsigned char> first_frame(g_decode_tier.frame_bytes());
+        std::string scratch, png_bytes;
+        if (g_decode_tier.decode(1, first_frame.data(), scratch)) {
+            encode_png_uncompressed(first_frame.data(), g_decode_tier.width(), g_decode_tier.height(), g_args.chroma_flag_given ? 4 : 3, png_bytes);
+            std::ofstream png_file(first_png_path, std::ios::binary);
+            png_file.write(png_bytes.data(), static_cast<std::streamsize>(png_bytes.size()));
+        } else {
+            {
+                std::lock_guard<std::mutex> lock(g_cerr_mutex);
+                std::cerr << "Warning: Decode cache is damaged at frame 1; decoding with FFmpeg and rebuilding it: " << g_decode_tier_path.string() << '\n';
+            }
+            std::error_code ec;
+            std::filesystem::remove(g_decode_tier_path, ec);
+            g_decode_tier.close();
+        }
+    }
+    if (!g_decode_tier.is_open()) {
+        // Extract just the first frame
+        if (run_command_silent_ex({"ffmpeg", "-i", g_args.filename, "-vf", build_video_filter(0, 0), "-vframes", "1", "-y", first_png_path.string()},
+                                  !g_args.verbose) != 0) {
+            std::filesystem::remove_all(temp_first_frame_dir);
+            g_pipeline_error_occurred.store(true);
+            return false;
+        }
+    }
+
+    if (!std::filesystem::exists(first_png_path)) {
+         std::lock_guard<std::mutex> lock(g_cerr_mutex);
         std::cerr << "ERROR: First frame PNG (" << first_png_path << ") not found after FFmpeg extraction.\n";
         std::filesystem::remove_all(temp_first_frame_dir);
         g_pipeline_error_occurred.store(true);
@@ -324,15 +3107,13 @@ bool predetermine_actual_chafa_height() {
     }
 
     // Convert first frame with Chafa to get its height
-    std::string chafa_cmd = "chafa " + g_args.chafa_arguments + " --format symbols --size=" +
-                            std::to_string(g_args.width) + "x" + std::to_string(g_args.height_arg) +
-                            " \"" + first_png_path.string() + "\"";
+    const std::vector<std::string> chafa_cmd = chafa_command(g_args.height_arg, first_png_path.string());
     std::string ascii_output = run_command_with_output_ex(chafa_cmd);
     std::filesystem::remove_all(temp_first_frame_dir); // Clean up temp dir
 
     if (ascii_output.empty()) {
         std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ERROR: Chafa produced no output for the first frame during height check (command: " << chafa_cmd << ").\n";
+        std::cerr << "ERROR: Chafa produced no output for the first frame during height check (command: " << describe_command(chafa_cmd) << ").\n";
         g_pipeline_error_occurred.store(true);
         return false;
     }
@@ -353,208 +3134,1246 @@ bool predetermine_actual_chafa_height() {
     return true;
 }
 
-// FFmpeg worker: extracts frames from a specific video segment
-void process_video_segment(int segment_idx, double start_time, double segment_duration,
+// Progressive Frame Store
+// With --progressive, playback starts while the cache is still being built. Commit tasks publish each
+// finished frame here as well as to disk, and the player shows the contiguous run of ready frames from
+// the start until the background build has written the frame pack.
+class ProgressiveFrameStore {
+public:
+    void start(size_t expected_frames) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        frames_.assign(expected_frames, std::string());
+        ready_.assign(expected_frames, false);
+        ready_prefix_ = 0;
+        complete_ = false;
+        active_.store(true);
+    }
+
+    bool active() const { return active_.load(); }
+
+    bool complete() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return complete_;
+    }
+
+    // An empty text marks a frame the renderer produced nothing for; the player keeps the previous one
+    void publish(int frame_number, std::string text) {
+        if (!active_.load() || frame_number <= 0) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            size_t index = static_cast<size_t>(frame_number - 1);
+            if (index >= frames_.size()) { // More frames than the duration estimate
+                frames_.resize(index + 1);
+                ready_.resize(index + 1, false);
+            }
+            frames_[index] = std::move(text);
+            ready_[index] = true;
+            while (ready_prefix_ < ready_.size() && ready_[ready_prefix_]) ++ready_prefix_;
+        }
+        ready_cv_.notify_all();
+    }
+
+    size_t ready_prefix() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ready_prefix_;
+    }
+
+    // Stays valid while the store is alive: published frames are never touched again and
+    // std::deque keeps element addresses stable as it grows
+    std::string_view frame(size_t index) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return frames_[index];
+    }
+
+    // Wait until `count` frames from the start are ready or the build has finished
+    bool wait_for_frames(size_t count, std::chrono::milliseconds timeout) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        ready_cv_.wait_for(lock, timeout, [&] { return ready_prefix_ >= count || complete_ || g_pipeline_error_occurred.load(); });
+        return ready_prefix_ >= count;
+    }
+
+    // Called once the frame pack and the cache metadata are in place
+    void finish() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            complete_ = true;
+        }
+        ready_cv_.notify_all();
+    }
+
+private:
+    std::deque<std::string> frames_;
+    std::vector<bool> ready_;
+    size_t ready_prefix_ = 0;
+    bool complete_ = false;
+    std::atomic<bool> active_{false};
+    std::mutex mutex_;
+    std::condition_variable ready_cv_;
+};
+
+ProgressiveFrameStore g_progressive_frames;
+
+// Route a frame conversion through the frame-ordered lane when the player is waiting on the build
+void submit_convert_task(int frame_number, std::function<void()> fn) {
+    if (g_progressive_frames.active()) g_task_pool.submit_ordered(TaskStage::Convert, frame_number, std::move(fn));
+    else g_task_pool.submit(TaskStage::Convert, std::move(fn));
+}
+
+// PNG Frame Events
+// In PNG mode the dispatcher sleeps until a segment directory reports a finished frame. On Linux that
+// is inotify IN_CLOSE_WRITE / IN_MOVED_TO, so a frame is handed off the moment FFmpeg closes it and never
+// while half written. Elsewhere it wakes every 30 ms and lists the directories instead. Decode tasks
+// poke a wake pipe when they finish so the final sweep starts without delay on either path.
+class PngFrameEvents {
+public:
+    ~PngFrameEvents() { close(); }
+
+    bool open(const std::vector<std::filesystem::path>& segment_dirs) {
+        close();
+        if (pipe(wake_fds_) != 0) {
+            wake_fds_[0] = wake_fds_[1] = -1;
+            return false;
+        }
+        for (int fd : wake_fds_) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+            fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+#ifdef __linux__
+        inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotify_fd_ >= 0) {
+            for (size_t i = 0; i < segment_dirs.size(); ++i) {
+                int wd = inotify_add_watch(inotify_fd_, segment_dirs[i].c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+                if (wd < 0) { // Mixing watched and unwatched directories isn't worth it; poll everything
+                    print_verbose("inotify_add_watch failed for " + segment_dirs[i].string() + ": " + strerror(errno) + ". Falling back to polling.");
+                    ::close(inotify_fd_);
+                    inotify_fd_ = -1;
+                    watch_segments_.clear();
+                    break;
+                }
+                watch_segments_[wd] = i;
+            }
+        } else {
+            print_verbose(std::string("inotify_init1 failed: ") + strerror(errno) + ". Falling back to polling.");
+        }
+#else
+        (void)segment_dirs;
+#endif
+        return true;
+    }
+
+    void close() {
+        if (inotify_fd_ >= 0) ::close(inotify_fd_);
+        inotify_fd_ = -1;
+        watch_segments_.clear();
+        int write_fd = wake_fds_[1];
+        wake_fds_[1] = -1; // Stop wake() from using it before it is closed
+        if (write_fd >= 0) ::close(write_fd);
+        if (wake_fds_[0] >= 0) ::close(wake_fds_[0]);
+        wake_fds_[0] = -1;
+    }
+
+    bool uses_inotify() const { return inotify_fd_ >= 0; }
+
+    // Interrupt wait(); safe from any thread
+    void wake() {
+        int fd = wake_fds_[1];
+        if (fd >= 0) {
+            char byte = 1;
+            ssize_t ignored = write(fd, &byte, 1); // A full pipe already means a wake-up is pending
+            (void)ignored;
+        }
+    }
+
+    // Block until something may have changed. Appends (segment index, file name) for every file reported
+    // as complete, and sets needs_sweep when the directories have to be listed (polling mode or overflow).
+    void wait(std::vector<std::pair<size_t, std::string>>& ready, bool& needs_sweep) {
+        needs_sweep = !uses_inotify();
+        struct pollfd fds[2];
+        nfds_t nfds = 0;
+        if (wake_fds_[0] >= 0) fds[nfds++] = {wake_fds_[0], POLLIN, 0};
+        if (inotify_fd_ >= 0) fds[nfds++] = {inotify_fd_, POLLIN, 0};
+        if (poll(fds, nfds, uses_inotify() ? 250 : 30) <= 0) return; // The timeout only guards against lost wake-ups
+
+        if (wake_fds_[0] >= 0) {
+            char drain[64];
+            while (read(wake_fds_[0], drain, sizeof(drain)) > 0) {}
+        }
+#ifdef __linux__
+        if (inotify_fd_ < 0) return;
+        alignas(struct inotify_event) char buffer[4096];
+        while (true) {
+            ssize_t len = read(inotify_fd_, buffer, sizeof(buffer));
+            if (len <= 0) break;
+            for (char* ptr = buffer; ptr < buffer + len;) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+                ptr += sizeof(struct inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW) {
+                    needs_sweep = true;
+                    continue;
+                }
+                auto it = watch_segments_.find(event->wd);
+                if (it != watch_segments_.end() && event->len > 0) ready.push_back({it->second, event->name});
+            }
+        }
+#endif
+    }
+
+private:
+    int wake_fds_[2] = {-1, -1};
+    int inotify_fd_ = -1;
+    std::map<int, size_t> watch_segments_; // inotify watch descriptor -> segment index
+};
+
+PngFrameEvents g_png_frame_events;
+
+// Render Journal
+// A cache build stages one .txt per frame under .cache/frames/<key>.render/ and appends a record for
+// every finished frame (number, length, XXH64 of the text) to its journal, below the segment layout
+// the build was planned with. An interrupted or failed build leaves both behind, and the next run
+// keeps each frame whose file still matches its record and decodes only the missing frame ranges.
+constexpr const char* kRenderJournalMagic = "anifetch-render-journal 1";
+
+struct RenderSegment {
+    double start = 0.0;
+    double duration = 0.0;
+    int base_frame = 0;  // Frames of this segment are numbered from base_frame + 1
+    int frame_count = 0; // Frames expected from it at the target framerate
+};
+
+class RenderJournal {
+public:
+    // No locking here: exit() can run from a signal handler on a worker that holds mutex_
+    ~RenderJournal() {
+        if (fd_ >= 0) ::close(fd_);
+    }
+
+    static std::string frame_file_name(int frame_number) {
+        std::ostringstream name;
+        name << std::setfill('0') << std::setw(9) << frame_number << ".txt";
+        return name.str();
+    }
+
+    // Start a fresh journal for this layout
+    bool create(const std::filesystem::path& journal_path, int rows, const std::vector<RenderSegment>& segments) {
+        close();
+        std::ostringstream header;
+        header << kRenderJournalMagic << "\nrows " << rows << '\n' << std::setprecision(17);
+        for (const auto& segment : segments) {
+            header << "segment " << segment.start << ' ' << segment.duration << ' ' << segment.base_frame << ' ' << segment.frame_count << '\n';
+        }
+        fd_ = ::open(journal_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        return fd_ >= 0 && write_all(header.str());
+    }
+
+    // Keep appending to a journal that load() accepted
+    bool reopen(const std::filesystem::path& journal_path) {
+        close();
+        fd_ = ::open(journal_path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        return fd_ >= 0;
+    }
+
+    // Read the layout of an existing journal and the frames in frames_dir that still match their
+    // records. Frame files without a matching record are partial leftovers and get deleted. Returns
+    // false if there is no journal, or it was written for a different frame height.
+    static bool load(const std::filesystem::path& journal_path, const std::filesystem::path& frames_dir, int rows,
+                     std::vector<RenderSegment>& segments, std::set<int>& completed) {
+        segments.clear();
+        completed.clear();
+        std::ifstream journal(journal_path);
+        std::string line;
+        if (!std::getline(journal, line) || line != kRenderJournalMagic) return false;
+        std::map<int, std::pair<size_t, std::string>> records; // Frame -> (length, hash); the last record wins
+        bool rows_match = false;
+        while (std::getline(journal, line)) {
+            std::istringstream fields(line);
+            std::string kind;
+            fields >> kind;
+            if (kind == "rows") {
+                int journal_rows = 0;
+                rows_match = (fields >> journal_rows) && journal_rows == rows;
+            } else if (kind == "segment") {
+                RenderSegment segment;
+                if (fields >> segment.start >> segment.duration >> segment.base_frame >> segment.frame_count) segments.push_back(segment);
+            } else if (kind == "frame") {
+                int frame_number = 0;
+                size_t length = 0;
+                std::string hash;
+                if (fields >> frame_number >> length >> hash) records[frame_number] = {length, hash}; // A torn last line fails here
+            }
+        }
+        if (!rows_match || segments.empty()) return false;
+
+        std::error_code ec;
+        for (const auto& entry : std::filesystem::directory_iterator(frames_dir, ec)) {
+            if (entry.path().extension() != ".txt") continue;
+            int frame_number = 0;
+            const std::string stem = entry.path().stem().string();
+            auto parsed = std::from_chars(stem.data(), stem.data() + stem.size(), frame_number);
+            auto record = records.end();
+            if (parsed.ec == std::errc() && parsed.ptr == stem.data() + stem.size()) record = records.find(frame_number);
+            bool verified = false;
+            if (record != records.end() && entry.file_size(ec) == record->second.first) {
+                std::ifstream frame_file(entry.path(), std::ios::binary);
+                std::string text((std::istreambuf_iterator<char>(frame_file)), std::istreambuf_iterator<char>());
+                verified = text.size() == record->second.first && hash_to_hex(xxhash64(text.data(), text.size())) == record->second.second;
+            }
+            if (verified) {
+                completed.insert(frame_number);
+            } else {
+                print_verbose("Render journal: discarding unverified frame " + entry.path().filename().string());
+                std::filesystem::remove(entry.path(), ec);
+            }
+        }
+        return true;
+    }
+
+    // Called by commit tasks once the frame's file has been written
+    void record(int frame_number, const std::string& text) {
+        const std::string line = "frame " + std::to_string(frame_number) + " " + std::to_string(text.size()) + " " +
+                                 hash_to_hex(xxhash64(text.data(), text.size())) + "\n";
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ >= 0) write_all(line);
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+    }
+
+private:
+    // One write() per record on an O_APPEND descriptor, so records from different workers never interleave
+    bool write_all(const std::string& text) {
+        size_t written = 0;
+        while (written < text.size()) {
+            ssize_t n = ::write(fd_, text.data() + written, text.size() - written);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) return false;
+            written += static_cast<size_t>(n);
+        }
+        return true;
+    }
+
+    int fd_ = -1;
+    std::mutex mutex_;
+};
+
+RenderJournal g_render_journal;
+
+void close_chafa_batches();
+
+// Called once by every decode task; the last one to finish marks extraction as done
+void finish_decode_task() {
+    if (g_decode_tasks_remaining.fetch_sub(1) == 1) {
+        g_ffmpeg_extraction_done.store(true);
+        g_png_frame_events.wake();
+        if (g_args.decode_mode == "stream") close_chafa_batches(); // Stream decoders queue their frames' conversions themselves
+    }
+}
+
+// FFmpeg worker: extracts frames from a specific video segment (at most max_frames of them, if non-zero)
+void process_video_segment(int segment_idx, double start_time, double segment_duration, int max_frames,
                            const std::filesystem::path& output_dir) {
     if (g_pipeline_error_occurred.load()) {
         print_verbose("FFmpeg worker " + std::to_string(segment_idx) + ": Skipping (pipeline error).");
         return;
     }
-    print_verbose("FFmpeg worker " + std::to_string(segment_idx) + ": Processing segment (start: " +
-                  std::to_string(start_time) + "s, duration: " + std::to_string(segment_duration) + "s) -> " + output_dir.string());
-    std::filesystem::create_directories(output_dir);
-
-    std::string ffmpeg_filter_complex = "fps=" + std::to_string(g_args.framerate);
-    if (g_args.chroma_flag_given) {
-        ffmpeg_filter_complex += ",format=rgba,colorkey=" + g_args.chroma_arg + ":similarity=0.01:blend=0";
-    } else {
-        ffmpeg_filter_complex += ",format=rgb24";
+    print_verbose("FFmpeg worker " + std::to_string(segment_idx) + ": Processing segment (start: " +
+                  std::to_string(start_time) + "s, duration: " + std::to_string(segment_duration) + "s) -> " + output_dir.string());
+    std::filesystem::create_directories(output_dir);
+    ScopedStatTimer stat_timer(StatId::DecodeSegment);
+
+    std::vector<std::string> ffmpeg_cmd = {"ffmpeg", "-ss", std::to_string(start_time), "-i", g_args.filename, "-vf", build_video_filter(0, 0)};
+    // A frame count ends the segment exactly; only the final segment runs on for its duration
+    if (max_frames > 0) ffmpeg_cmd.insert(ffmpeg_cmd.end(), {"-frames:v", std::to_string(max_frames)});
+    else ffmpeg_cmd.insert(ffmpeg_cmd.end(), {"-t", std::to_string(segment_duration)});
+    ffmpeg_cmd.insert(ffmpeg_cmd.end(), {"-an", "-y", (output_dir / "%09d.png").string()}); // Output to segment dir
+
+    // Stopped as soon as any other part of the pipeline fails
+    if (run_command_silent_ex(ffmpeg_cmd, !g_args.verbose, &g_pipeline_error_occurred) != 0) {
+        g_pipeline_error_occurred.store(true); // Signal error
+    }
+    print_verbose("FFmpeg worker " + std::to_string(segment_idx) + ": Finished segment.");
+}
+
+// Save one converted frame as its ASCII frame file
+bool write_ascii_frame(const std::filesystem::path& ascii_output_path, const std::string& ascii_text, int worker_id) {
+    ScopedStatTimer stat_timer(StatId::FrameCommit);
+    std::ofstream ascii_file(ascii_output_path);
+    ascii_file << ascii_text;
+    ascii_file.close(); // Sets failbit if the file never opened or the data didn't reach it
+    if (!ascii_file.fail()) {
+        int count_after_increment = g_ascii_frames_completed.fetch_add(1) + 1;
+        print_verbose("CHAFA_WORKER_DEBUG: Wrote: " + ascii_output_path.filename().string() + ". Total ASCII: " + std::to_string(count_after_increment));
+        return true;
+    }
+    std::lock_guard<std::mutex> lock(g_cerr_mutex);
+    std::cerr << "ERROR: ASCII Converter " << worker_id << " failed to write output file: " << ascii_output_path << '\n';
+    g_pipeline_error_occurred.store(true);
+    return false;
+}
+
+// Queue the file write for a converted frame as its own task
+void submit_commit_task(int frame_number, std::filesystem::path ascii_output_path, std::string ascii_text) {
+    minimize_frame_text(ascii_text); // On the converting worker, so it runs as parallel as conversion
+    g_task_pool.submit(TaskStage::Commit, [frame_number, path = std::move(ascii_output_path), text = std::move(ascii_text)]() mutable {
+        if (g_pipeline_error_occurred.load()) return;
+        if (write_ascii_frame(path, text, TaskPool::current_worker())) g_render_journal.record(frame_number, text);
+        g_progressive_frames.publish(frame_number, std::move(text));
+    });
+}
+
+// Run Chafa on one frame image and queue the result as the matching ASCII frame file. The image is
+// png_file_path, or png_bytes fed through Chafa's stdin when given.
+void convert_single_png(const std::filesystem::path& png_file_path, int frame_number, int worker_id,
+                        const std::string_view* png_bytes = nullptr) {
+    std::filesystem::path ascii_output_path = g_processed_ascii_path / RenderJournal::frame_file_name(frame_number);
+    thread_local size_t output_size_hint = 0; // Frames of one clip convert to about the same size
+
+    std::string chafa_output_text;
+    chafa_output_text.reserve(output_size_hint);
+    {
+        ScopedStatTimer stat_timer(StatId::FrameConvert);
+        run_command_with_output_ex(chafa_command(g_args.actual_chafa_height, png_bytes ? "-" : png_file_path.string()),
+                                   chafa_output_text, png_bytes, &g_pipeline_error_occurred);
+    }
+    output_size_hint = std::max(output_size_hint, chafa_output_text.size());
+
+    if (!chafa_output_text.empty()) {
+        submit_commit_task(frame_number, std::move(ascii_output_path), std::move(chafa_output_text));
+    } else { // Chafa output was empty
+        print_verbose("WARNING: ASCII Converter " + std::to_string(worker_id) + " got empty output from Chafa for frame " + std::to_string(frame_number));
+        g_progressive_frames.publish(frame_number, std::string()); // Don't leave the player waiting on it
+    }
+}
+
+// Batched Chafa
+// Chafa converts every image named on its command line in turn, so one process can take a batch of
+// frames. Conversion tasks leave their frame with the batcher, and whichever task finds a full batch
+// waiting runs it. The batch size follows the backlog of frames still to convert: while it is long
+// each worker takes up to --chafa-batch frames per process, and as it runs out batches shrink to a
+// single frame so the last frames are spread over the workers instead of queueing behind each other.
+// Every frame is actual_chafa_height lines long, which is how the output is split back up.
+constexpr size_t kProgressiveChafaBatch = 4; // The player is waiting on the earliest of these frames
+
+struct ChafaBatchItem {
+    int frame_number = 0;
+    std::filesystem::path png_path; // Frame image on disk, or empty when png_bytes holds it
+    std::string png_bytes;
+};
+
+class ChafaBatcher {
+public:
+    // A build starts: about frames_due frames will be added, and frames keep coming until close()
+    void open(size_t frames_due) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.clear();
+        frames_due_ = frames_due;
+        closed_ = false;
+    }
+
+    // Every frame has been handed to a conversion task; batches no longer wait to fill up
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = true;
+    }
+
+    void add(ChafaBatchItem item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        items_.push_back(std::move(item));
+        if (frames_due_ > 0) frames_due_--;
+    }
+
+    // Take the next batch. Returns false when nothing is waiting, or when too little is waiting for a
+    // batch and frames still on their way will fill it. more_ready tells whether another batch could
+    // be taken right away.
+    bool take(std::vector<ChafaBatchItem>& batch, bool& more_ready) {
+        batch.clear();
+        more_ready = false;
+        const size_t queued = g_task_pool.queued(TaskStage::Convert);
+        const size_t workers = std::max(1u, g_task_pool.worker_count());
+        size_t limit = static_cast<size_t>(g_args.chafa_batch);
+        if (g_progressive_frames.active()) limit = std::min(limit, kProgressiveChafaBatch);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (items_.empty()) return false;
+        const size_t backlog = items_.size() + std::max(frames_due_, queued);
+        const size_t target = std::clamp(backlog / workers, static_cast<size_t>(1), limit);
+        if (items_.size() < target && !closed_) return false;
+        const size_t count = std::min(target, items_.size());
+        for (size_t i = 0; i < count; ++i) {
+            batch.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        more_ready = !items_.empty() && (items_.size() >= target || closed_);
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<ChafaBatchItem> items_;
+    size_t frames_due_ = 0; // Estimate of the frames not added yet
+    bool closed_ = false;
+};
+
+ChafaBatcher g_chafa_batcher;
+thread_local bool t_decoder_helping = false; // A decoder is running conversions while it waits for a frame slot
+std::atomic<bool> g_chafa_batch_split_ok(true); // Cleared once a batch's output didn't split into frames
+
+// Byte offsets where each frame of batched Chafa output ends. False unless the output is exactly
+// `frames` frames of `lines` newline-terminated lines.
+bool split_chafa_batch_output(const std::string& output, size_t frames, int lines, std::vector<size_t>& frame_ends) {
+    frame_ends.clear();
+    int line = 0;
+    for (size_t pos = output.find('\n'); pos != std::string::npos; pos = output.find('\n', pos + 1)) {
+        if (++line == lines) {
+            frame_ends.push_back(pos + 1);
+            line = 0;
+        }
+    }
+    return frame_ends.size() == frames && line == 0 && frame_ends.back() == output.size();
+}
+
+void convert_chafa_item(const ChafaBatchItem& item, int worker_id) {
+    if (item.png_path.empty()) {
+        const std::string_view png_view(item.png_bytes);
+        convert_single_png(std::filesystem::path(), item.frame_number, worker_id, &png_view);
+    } else {
+        convert_single_png(item.png_path, item.frame_number, worker_id);
+    }
+}
+
+// Convert a batch with one Chafa run and queue each frame's text. Frames held in memory are written
+// to g_batch_png_path for the run. If the output doesn't split cleanly the batch is converted again
+// one frame per run, and so is everything after it.
+void convert_chafa_batch(std::vector<ChafaBatchItem>& batch) {
+    const int worker_id = TaskPool::current_worker();
+    if (batch.size() == 1 || !g_chafa_batch_split_ok.load()) {
+        for (const auto& item : batch) convert_chafa_item(item, worker_id);
+        return;
+    }
+
+    std::vector<std::filesystem::path> written_pngs;
+    auto remove_written_pngs = [&written_pngs] {
+        std::error_code ec;
+        for (const auto& path : written_pngs) std::filesystem::remove(path, ec);
+    };
+    for (auto& item : batch) {
+        if (!item.png_path.empty()) continue;
+        item.png_path = g_batch_png_path / (std::to_string(item.frame_number) + ".png");
+        std::ofstream png_file(item.png_path, std::ios::binary);
+        png_file.write(item.png_bytes.data(), static_cast<std::streamsize>(item.png_bytes.size()));
+        png_file.close();
+        written_pngs.push_back(item.png_path);
+        if (png_file.fail()) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "ERROR: ASCII Converter " << worker_id << " failed to write batch frame: " << item.png_path << '\n';
+            g_pipeline_error_occurred.store(true);
+            remove_written_pngs();
+            return;
+        }
+        std::string().swap(item.png_bytes);
+    }
+
+    std::vector<std::string> chafa_cmd = chafa_command(g_args.actual_chafa_height, batch.front().png_path.string());
+    for (size_t i = 1; i < batch.size(); ++i) chafa_cmd.push_back(batch[i].png_path.string());
+    std::string chafa_output_text;
+    const auto started = std::chrono::steady_clock::now();
+    const bool ran = run_command_with_output_ex(chafa_cmd, chafa_output_text, nullptr, &g_pipeline_error_occurred);
+    if (g_stats_enabled) { // One sample per frame, so the figures stay comparable with unbatched runs
+        const uint64_t per_frame_ns = stat_elapsed_ns(started) / batch.size();
+        for (size_t i = 0; i < batch.size(); ++i) stat_record(StatId::FrameConvert, per_frame_ns);
+    }
+
+    std::vector<size_t> frame_ends;
+    if (ran && split_chafa_batch_output(chafa_output_text, batch.size(), g_args.actual_chafa_height, frame_ends)) {
+        size_t begin = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            submit_commit_task(batch[i].frame_number, g_processed_ascii_path / RenderJournal::frame_file_name(batch[i].frame_number),
+                               chafa_output_text.substr(begin, frame_ends[i] - begin));
+            begin = frame_ends[i];
+        }
+    } else if (!g_pipeline_error_occurred.load()) {
+        if (ran && g_chafa_batch_split_ok.exchange(false)) {
+            print_verbose("WARNING: Chafa output for a batch of " + std::to_string(batch.size()) + " frames did not split into frames of " +
+                          std::to_string(g_args.actual_chafa_height) + " lines; converting one frame per Chafa run from here on.");
+        }
+        for (const auto& item : batch) convert_chafa_item(item, worker_id);
+    }
+    remove_written_pngs();
+}
+
+// Run batches while the batcher hands them out. A decoder helping out leaves them to the workers;
+// close_chafa_batches() still comes after the last decoder.
+void run_chafa_batches() {
+    if (t_decoder_helping) return;
+    std::vector<ChafaBatchItem> batch;
+    bool more_ready = false;
+    while (!g_pipeline_error_occurred.load() && g_chafa_batcher.take(batch, more_ready)) {
+        // Let an idle worker start on the next batch instead of leaving it for after this one
+        if (more_ready && g_task_pool.queued(TaskStage::Convert) == 0) g_task_pool.submit(TaskStage::Convert, run_chafa_batches);
+        convert_chafa_batch(batch);
+    }
+}
+
+// No more frames are coming: convert whatever waits for a batch to fill up
+void close_chafa_batches() {
+    g_chafa_batcher.close();
+    g_task_pool.submit(TaskStage::Convert, run_chafa_batches);
+}
+
+// Convert one frame with Chafa, batched with other frames unless --chafa-batch is 1
+void convert_with_chafa(ChafaBatchItem item) {
+    if (g_args.chafa_batch == 1) {
+        convert_chafa_item(item, TaskPool::current_worker());
+        return;
+    }
+    g_chafa_batcher.add(std::move(item));
+    run_chafa_batches();
+}
+
+// Stream-mode conversion task: renders one raw frame natively, or hands it to Chafa as an uncompressed
+// PNG. Gives the ring slot back as soon as the pixels are consumed.
+void convert_raw_frame_task(int slot, int frame_number) {
+    if (g_pipeline_error_occurred.load()) {
+        g_raw_frame_ring.release(slot);
+        return;
+    }
+    const int channels = g_args.chroma_flag_given ? 4 : 3;
+
+    if (g_args.renderer == "native") {
+        std::string ascii_text;
+        {
+            ScopedStatTimer stat_timer(StatId::FrameConvert);
+            render_frame_native(g_raw_frame_ring.data(slot), g_stream_frame_width, g_stream_frame_height, channels, ascii_text);
+        }
+        g_raw_frame_ring.release(slot);
+        submit_commit_task(frame_number, g_processed_ascii_path / RenderJournal::frame_file_name(frame_number), std::move(ascii_text));
+        return;
+    }
+
+    ChafaBatchItem item;
+    item.frame_number = frame_number;
+    encode_png_uncompressed(g_raw_frame_ring.data(slot), g_stream_frame_width, g_stream_frame_height, channels, item.png_bytes);
+    g_raw_frame_ring.release(slot); // Pixels are no longer needed once encoded
+    convert_with_chafa(std::move(item));
+}
+
+// Take a free raw frame slot for a decoder, helping with conversions while every slot is taken.
+// Returns -1 once the pipeline has failed.
+int acquire_raw_frame_slot() {
+    while (!g_pipeline_error_occurred.load()) {
+        int slot = g_raw_frame_ring.try_acquire_free_slot();
+        if (slot >= 0) return slot;
+        // Every slot is waiting on conversion: help convert instead of idling
+        t_decoder_helping = true;
+        const bool helped = g_task_pool.run_pending_task(TaskStage::Convert);
+        t_decoder_helping = false;
+        if (!helped) {
+            g_raw_frame_ring.wait_for_free_slot(std::chrono::milliseconds(5));
+        }
+    }
+    return -1;
+}
+
+// Queue the conversion of the raw frame in `slot`
+void submit_raw_frame(int slot, int frame_number) {
+    const auto handed_off_at = std::chrono::steady_clock::now();
+    submit_convert_task(frame_number, [slot, frame_number, handed_off_at] {
+        if (g_stats_enabled) stat_record(StatId::FrameHandOff, stat_elapsed_ns(handed_off_at));
+        convert_raw_frame_task(slot, frame_number);
+    });
+    g_pngs_ready_for_ascii++;
+}
+
+// Decode-cache worker: replays frames first_frame..last_frame of the decoded-frame tier into the ring,
+// starting from the keyframe before them
+void stream_tier_range(int range_idx, int first_frame, int last_frame) {
+    if (g_pipeline_error_occurred.load()) return;
+    print_verbose("Decode cache worker " + std::to_string(range_idx) + ": Frames " + std::to_string(first_frame) + "-" + std::to_string(last_frame));
+    ScopedStatTimer stat_timer(StatId::DecodeSegment);
+    std::vector<unsigned char> frame(g_decode_tier.frame_bytes());
+    std::string scratch;
+    last_frame = std::min(last_frame, g_decode_tier.frame_count());
+    for (int frame_number = g_decode_tier.keyframe_for(first_frame); frame_number <= last_frame; ++frame_number) {
+        if (!g_decode_tier.decode(frame_number, frame.data(), scratch)) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex);
+            std::cerr << "ERROR: Decode cache is damaged at frame " << frame_number << "; it will be rebuilt on the next run: " << g_decode_tier_path.string() << '\n';
+            std::error_code ec;
+            std::filesystem::remove(g_decode_tier_path, ec); // The mapping stays valid until it is closed
+            g_pipeline_error_occurred.store(true);
+            return;
+        }
+        if (frame_number < first_frame) continue;
+        int slot = acquire_raw_frame_slot();
+        if (slot < 0) return;
+        std::memcpy(g_raw_frame_ring.data(slot), frame.data(), frame.size());
+        submit_raw_frame(slot, frame_number);
+    }
+}
+
+// Stream worker: decodes a video segment to rawvideo over a pipe and hands each frame to a conversion task
+// (at most max_frames of them, if non-zero). When a decode cache is being built, each frame also goes there.
+void stream_video_segment(int segment_idx, double start_time, double segment_duration, int max_frames, int base_frame_index) {
+    if (g_pipeline_error_occurred.load()) {
+        print_verbose("Stream worker " + std::to_string(segment_idx) + ": Skipping (pipeline error).");
+        return;
+    }
+    print_verbose("Stream worker " + std::to_string(segment_idx) + ": Processing segment (start: " +
+                  std::to_string(start_time) + "s, duration: " + std::to_string(segment_duration) + "s)");
+    ScopedStatTimer stat_timer(StatId::DecodeSegment);
+
+    std::vector<std::string> ffmpeg_cmd = {"ffmpeg", "-ss", std::to_string(start_time), "-i", g_args.filename,
+                                           "-vf", build_video_filter(g_stream_frame_width, g_stream_frame_height)};
+    if (max_frames > 0) ffmpeg_cmd.insert(ffmpeg_cmd.end(), {"-frames:v", std::to_string(max_frames)});
+    else ffmpeg_cmd.insert(ffmpeg_cmd.end(), {"-t", std::to_string(segment_duration)});
+    ffmpeg_cmd.insert(ffmpeg_cmd.end(), {"-an", "-f", "rawvideo", "-pix_fmt", g_args.chroma_flag_given ? "rgba" : "rgb24", "pipe:1"});
+    print_verbose("Executing for stream: " + describe_command(ffmpeg_cmd));
+    SubprocessReader ffmpeg;
+    if (!ffmpeg.start(ffmpeg_cmd, !g_args.verbose)) {
+        g_pipeline_error_occurred.store(true);
+        return;
     }
 
-    std::string ffmpeg_cmd = "ffmpeg -ss " + std::to_string(start_time) +
-                             " -i \"" + g_args.filename + "\"" +
-                             " -t " + std::to_string(segment_duration) + // Duration of this segment
-                             " -vf \"" + ffmpeg_filter_complex + "\"" +
-                             " -an -y \"" + (output_dir / "%09d.png").string() + "\""; // Output to segment dir
+    const size_t frame_bytes = g_raw_frame_ring.frame_bytes();
+    int frames_read = 0;
+    while (true) {
+        int slot = acquire_raw_frame_slot();
+        if (slot < 0) break;
+        size_t got = ffmpeg.read_exact(g_raw_frame_ring.data(slot), frame_bytes);
+        if (got != frame_bytes) {
+            g_raw_frame_ring.release(slot);
+            if (got != 0) print_verbose("Stream worker " + std::to_string(segment_idx) + ": Dropping truncated trailing frame.");
+            break;
+        }
+        const int frame_number = base_frame_index + frames_read + 1;
+        if (g_decode_tier_writer.active()) g_decode_tier_writer.add_frame(static_cast<size_t>(segment_idx), frame_number, g_raw_frame_ring.data(slot));
+        submit_raw_frame(slot, frame_number);
+        frames_read++;
+    }
 
-    if (run_command_silent_ex(ffmpeg_cmd, !g_args.verbose) != 0) {
-        g_pipeline_error_occurred.store(true); // Signal error
+    const bool stopped_early = g_pipeline_error_occurred.load(); // Nobody wants the rest of its frames
+    if (ffmpeg.finish(stopped_early) != 0 && !stopped_early) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ERROR: Command failed: " << describe_command(ffmpeg_cmd) << '\n';
+        g_pipeline_error_occurred.store(true);
     }
-    print_verbose("FFmpeg worker " + std::to_string(segment_idx) + ": Finished segment.");
+    print_verbose("Stream worker " + std::to_string(segment_idx) + ": Finished segment (" + std::to_string(frames_read) + " frames).");
 }
 
-// Dispatcher worker: monitors FFmpeg segment outputs, renames PNGs, and queues them for ASCII conversion
+// Dispatcher: waits for FFmpeg to finish frames in the segment directories, renames them into global
+// frame order, and submits them for ASCII conversion
 void prepare_png_frames(const std::vector<std::filesystem::path>& segment_dirs,
                         const std::vector<int>& segment_base_frame_indices) {
     if (g_pipeline_error_occurred.load()) {
         print_verbose("PNG Preparer: Skipping (pipeline error).");
-        g_png_processing_done.store(true); // Signal completion to allow Chafa workers to exit
-        g_conversion_queue_cv.notify_all();
         return;
     }
-    print_verbose("PNG Preparer: Monitoring " + std::to_string(segment_dirs.size()) + " segment directories.");
-    std::vector<int> next_png_idx_in_segment(segment_dirs.size(), 1); // Next local PNG
+    print_verbose("PNG Preparer: Watching " + std::to_string(segment_dirs.size()) + " segment directories (" +
+                  (g_png_frame_events.uses_inotify() ? "inotify" : "polling") + ").");
+
+    // Move one finished segment PNG into place and queue its conversion. Returns false if the name
+    // isn't a frame or the file was already handed off.
+    auto hand_off = [&](size_t segment, const std::string& file_name) {
+        std::filesystem::path source_png_path = segment_dirs[segment] / file_name;
+        if (source_png_path.extension() != ".png") return false;
+        const std::string stem = source_png_path.stem().string();
+        int local_index = 0;
+        auto parsed = std::from_chars(stem.data(), stem.data() + stem.size(), local_index);
+        if (parsed.ec != std::errc() || parsed.ptr != stem.data() + stem.size() || local_index <= 0) return false;
+
+        const int frame_number = segment_base_frame_indices[segment] + local_index;
+        std::ostringstream final_png_name_builder;
+        final_png_name_builder << std::setfill('0') << std::setw(9) << frame_number << ".png";
+        std::filesystem::path final_png_path = g_processed_png_path / final_png_name_builder.str();
+
+        // Hand-off latency: from FFmpeg finishing the file to it being queued for conversion
+        struct stat png_stat;
+        const bool have_png_stat = g_stats_enabled && stat(source_png_path.c_str(), &png_stat) == 0;
+
+        std::error_code ec;
+        std::filesystem::rename(source_png_path, final_png_path, ec);
+        if (ec) {
+            if (ec != std::errc::no_such_file_or_directory) {
+                std::lock_guard<std::mutex> lock(g_cerr_mutex);
+                std::cerr << "ERROR: PNG Preparer failed to move " << source_png_path << " to " << final_png_path << ". What: " << ec.message() << '\n';
+            }
+            return false;
+        }
+        if (have_png_stat) {
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            int64_t latency_ns = (static_cast<int64_t>(now.tv_sec) - png_stat.st_mtim.tv_sec) * 1000000000LL + (now.tv_nsec - png_stat.st_mtim.tv_nsec);
+            stat_record(StatId::FrameHandOff, static_cast<uint64_t>(std::max<int64_t>(0, latency_ns)));
+        }
+        submit_convert_task(frame_number, [final_png_path, frame_number] {
+            if (g_pipeline_error_occurred.load()) return;
+            ChafaBatchItem item;
+            item.frame_number = frame_number;
+            item.png_path = final_png_path;
+            convert_with_chafa(std::move(item));
+        });
+        g_pngs_ready_for_ascii++;
+        return true;
+    };
 
-    bool work_possible = true;
-    while (work_possible && !g_pipeline_error_occurred.load()) {
-        bool file_processed_this_cycle = false;
+    // List the segment directories for frames no event reported. While FFmpeg is still writing, the
+    // newest file of a segment may be partial, so it is left for a later pass.
+    auto sweep = [&](bool extraction_finished) {
         for (size_t i = 0; i < segment_dirs.size(); ++i) {
-            if (g_pipeline_error_occurred.load()) break; // Exit early on global error
-
-            if (!std::filesystem::exists(segment_dirs[i]) && g_ffmpeg_extraction_done.load()) {
-                 continue;
+            std::vector<std::string> names;
+            std::error_code ec;
+            for (const auto& entry : std::filesystem::directory_iterator(segment_dirs[i], ec)) {
+                if (entry.path().extension() == ".png") names.push_back(entry.path().filename().string());
             }
+            std::sort(names.begin(), names.end()); // Zero-padded, so lexical order is frame order
+            if (!extraction_finished && !names.empty()) names.pop_back();
+            for (const auto& name : names) hand_off(i, name);
+        }
+    };
 
-            std::ostringstream png_name_builder;
-            png_name_builder << std::setfill('0') << std::setw(9) << next_png_idx_in_segment[i] << ".png";
-            std::filesystem::path source_png_path = segment_dirs[i] / png_name_builder.str();
+    std::vector<std::pair<size_t, std::string>> ready;
+    while (!g_pipeline_error_occurred.load()) {
+        if (g_ffmpeg_extraction_done.load()) { // Every file is complete now; pick up anything left
+            sweep(true);
+            break;
+        }
+        bool needs_sweep = false;
+        ready.clear();
+        g_png_frame_events.wait(ready, needs_sweep);
+        for (const auto& item : ready) hand_off(item.first, item.second);
+        if (needs_sweep) sweep(false);
+    }
+    print_verbose("PNG Preparer: Finished. Total PNGs queued: " + std::to_string(g_pngs_ready_for_ascii.load()));
+}
 
-            if (std::filesystem::exists(source_png_path)) {
-                int global_frame_num_0based = segment_base_frame_indices[i] + next_png_idx_in_segment[i] - 1;
+// Warm-start Manifest
+// One small binary file per video path and argument set holding everything a cache hit needs: the
+// video's stat fingerprint, the frame pack's path, frame count, rows, payload size and header checksum,
+// and the sound path and video duration. It is written atomically after every render and every cache
+// hit that went through the full check. A warm start stats the video, reads the manifest and checks
+// the pack header against it, skipping the content hash, cache.txt and ffprobe. Any disagreement
+// falls back to prepare_animation_assets, which writes a new manifest.
+constexpr char kManifestMagic[8] = {'A', 'N', 'I', 'M', 'A', 'N', 'F', '1'};
+constexpr uint32_t kManifestVersion = 1;
+
+struct ManifestHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t rows;                 // Text rows per frame (the actual Chafa height)
+    uint64_t frame_count;
+    uint64_t video_size;           // Stat fingerprint of the video the frames were rendered from
+    uint64_t video_mtime_ns;
+    uint64_t video_ctime_ns;
+    uint64_t video_inode;
+    uint64_t video_device;
+    uint64_t pack_payload_size;
+    uint64_t pack_header_checksum; // XXH64 of the frame pack header
+    double video_duration;
+    uint32_t pack_path_length;     // The strings follow the header in this order, then an XXH64 of
+    uint32_t sound_path_length;    // everything before it
+    uint32_t identity_length;
+    uint32_t reserved;
+};
 
-                std::ostringstream final_png_name_builder;
-                final_png_name_builder << std::setfill('0') << std::setw(9) << global_frame_num_0based + 1 << ".png";
-                std::filesystem::path final_png_path = g_processed_png_path / final_png_name_builder.str();
+std::filesystem::path g_manifest_path;
+struct stat g_video_stat{}; // Taken right before the video's content identity was computed
 
-                try {
-                    std::filesystem::rename(source_png_path, final_png_path);
+uint64_t stat_time_ns(const struct timespec& ts) {
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ULL + static_cast<uint64_t>(ts.tv_nsec);
+}
 
-                    {
-                        std::lock_guard<std::mutex> lock(g_conversion_queue_mutex);
-                        g_ascii_conversion_queue.push({final_png_path, global_frame_num_0based + 1});
-                    }
-                    g_conversion_queue_cv.notify_one();
-                    g_pngs_ready_for_ascii++;
-                    next_png_idx_in_segment[i]++;
-                    file_processed_this_cycle = true;
-                } catch (const std::filesystem::filesystem_error& e) {
-                    std::lock_guard<std::mutex> lock(g_cerr_mutex);
-                    std::cerr << "ERROR: PNG Preparer failed to move " << source_png_path << " to " << final_png_path << ". What: " << e.what() << '\n';
-                    // Increment anyway to avoid getting stuck, but this might mean a lost frame
-                    next_png_idx_in_segment[i]++;
-                }
-            }
-        }
+// Keyed by the absolute video path and every input argument except the content identity, so it can
+// be found without reading the video
+std::filesystem::path manifest_path_for_args() {
+    std::map<std::string, std::string> key = g_args.to_input_map();
+    key.erase("video_file_identity");
+    key["filename"] = g_args.filename;
+    key["sound_flag"] = g_args.sound_flag_given ? "1" : "0";
+    return std::filesystem::current_path() / ".cache" / "manifests" / (hash_args_map(key) + ".bin");
+}
 
-        if (g_ffmpeg_extraction_done.load()) {
-            bool all_segments_processed = true;
-            for (size_t i = 0; i < segment_dirs.size(); ++i) {
-                std::ostringstream next_png_builder;
-                next_png_builder << std::setfill('0') << std::setw(9) << next_png_idx_in_segment[i] << ".png";
-                if (std::filesystem::exists(segment_dirs[i] / next_png_builder.str())) {
-                    all_segments_processed = false;
-                    break;
-                }
-            }
-            if (all_segments_processed) {
-                work_possible = false;
-            }
+void write_manifest(double video_duration) {
+    FramePack pack;
+    if (g_manifest_path.empty() || g_video_stat.st_ino == 0 || !pack.open(g_frame_pack_path)) return;
+    ManifestHeader header{};
+    std::memcpy(header.magic, kManifestMagic, sizeof(kManifestMagic));
+    header.version = kManifestVersion;
+    header.rows = static_cast<uint32_t>(g_args.actual_chafa_height);
+    header.frame_count = static_cast<uint64_t>(g_args.num_frames);
+    header.video_size = static_cast<uint64_t>(g_video_stat.st_size);
+    header.video_mtime_ns = stat_time_ns(g_video_stat.st_mtim);
+    header.video_ctime_ns = stat_time_ns(g_video_stat.st_ctim);
+    header.video_inode = static_cast<uint64_t>(g_video_stat.st_ino);
+    header.video_device = static_cast<uint64_t>(g_video_stat.st_dev);
+    header.pack_payload_size = pack.payload_size();
+    header.pack_header_checksum = pack.header_checksum();
+    header.video_duration = video_duration;
+    const std::string pack_path = g_frame_pack_path.string();
+    header.pack_path_length = static_cast<uint32_t>(pack_path.size());
+    header.sound_path_length = static_cast<uint32_t>(g_args.sound_saved_path.size());
+    header.identity_length = static_cast<uint32_t>(g_args.video_identity.size());
+
+    std::string data(reinterpret_cast<const char*>(&header), sizeof(header));
+    data += pack_path;
+    data += g_args.sound_saved_path;
+    data += g_args.video_identity;
+    const uint64_t checksum = xxhash64(data.data(), data.size());
+    data.append(reinterpret_cast<const char*>(&checksum), sizeof(checksum));
+
+    std::error_code ec;
+    std::filesystem::create_directories(g_manifest_path.parent_path(), ec);
+    std::filesystem::path temp_path = g_manifest_path;
+    temp_path += "." + std::to_string(getpid()) + ".tmp"; // Another instance may write the same manifest
+    {
+        std::ofstream manifest_stream(temp_path, std::ios::binary | std::ios::trunc);
+        manifest_stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!manifest_stream) {
+            std::filesystem::remove(temp_path, ec);
+            return;
         }
+    }
+    std::filesystem::rename(temp_path, g_manifest_path, ec);
+    if (ec) std::filesystem::remove(temp_path, ec);
+    else print_verbose("Wrote manifest " + g_manifest_path.string());
+}
 
-        if (!file_processed_this_cycle && work_possible && !g_pipeline_error_occurred.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(30));
-        }
+// Warm start: take everything from the manifest if the video and the frame pack are exactly as it
+// recorded them. Returns false to go through prepare_animation_assets instead.
+bool load_manifest() {
+    std::error_code ec;
+    g_args.filename = std::filesystem::absolute(g_args.filename, ec).string();
+    if (ec) return false;
+    g_manifest_path = manifest_path_for_args();
+
+    struct stat video_stat;
+    if (stat(g_args.filename.c_str(), &video_stat) != 0) return false;
+    int fd = ::open(g_manifest_path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    char buffer[16384]; // Far more than a manifest with any real paths needs
+    ssize_t length = read(fd, buffer, sizeof(buffer));
+    ::close(fd);
+
+    ManifestHeader header;
+    if (length < static_cast<ssize_t>(sizeof(header) + sizeof(uint64_t))) return false;
+    std::memcpy(&header, buffer, sizeof(header));
+    const size_t strings_length = static_cast<size_t>(header.pack_path_length) + header.sound_path_length + header.identity_length;
+    if (std::memcmp(header.magic, kManifestMagic, sizeof(kManifestMagic)) != 0 || header.version != kManifestVersion ||
+        static_cast<size_t>(length) != sizeof(header) + strings_length + sizeof(uint64_t)) {
+        print_verbose("Manifest " + g_manifest_path.string() + " is damaged or from another version.");
+        return false;
     }
-    g_png_processing_done.store(true);
-    g_conversion_queue_cv.notify_all();
-    print_verbose("PNG Preparer: Finished. Total PNGs queued: " + std::to_string(g_pngs_ready_for_ascii.load()));
+    uint64_t checksum;
+    std::memcpy(&checksum, buffer + sizeof(header) + strings_length, sizeof(checksum));
+    if (checksum != xxhash64(buffer, sizeof(header) + strings_length)) {
+        print_verbose("Manifest " + g_manifest_path.string() + " failed its checksum.");
+        return false;
+    }
+    if (header.video_size != static_cast<uint64_t>(video_stat.st_size) || header.video_mtime_ns != stat_time_ns(video_stat.st_mtim) ||
+        header.video_ctime_ns != stat_time_ns(video_stat.st_ctim) || header.video_inode != static_cast<uint64_t>(video_stat.st_ino) ||
+        header.video_device != static_cast<uint64_t>(video_stat.st_dev)) {
+        print_verbose("Manifest: the video changed on disk since it was written; checking the cache in full.");
+        return false;
+    }
+
+    const char* strings = buffer + sizeof(header);
+    const std::filesystem::path pack_path(std::string(strings, header.pack_path_length));
+    std::string sound_path(strings + header.pack_path_length, header.sound_path_length);
+    FramePack pack;
+    if (header.frame_count == 0 || !pack.open(pack_path) || pack.frame_count() != header.frame_count || pack.rows() != static_cast<int>(header.rows) ||
+        pack.payload_size() != header.pack_payload_size || pack.header_checksum() != header.pack_header_checksum) {
+        print_verbose("Manifest: frame pack " + pack_path.string() + " is missing or was replaced.");
+        return false;
+    }
+    if (!sound_path.empty() && access(sound_path.c_str(), R_OK) != 0) return false;
+
+    g_frame_pack_path = pack_path;
+    g_args.sound_saved_path = std::move(sound_path);
+    g_args.video_identity.assign(strings + header.pack_path_length + header.sound_path_length, header.identity_length);
+    g_args.num_frames = static_cast<int>(header.frame_count);
+    g_args.actual_chafa_height = static_cast<int>(header.rows);
+    g_video_stat = video_stat;
+    print_verbose("Warm start from " + g_manifest_path.string() + ": " + std::to_string(g_args.num_frames) + " frames in " + pack_path.string());
+    return true;
 }
 
-void convert_png_to_ascii(int worker_id) {
-    print_verbose("ASCII Converter " + std::to_string(worker_id) + ": Started.");
-    while (true) {
-        if (g_pipeline_error_occurred.load() && g_ascii_conversion_queue.empty()) {
-             break;
+// Record the arguments and derived values of this render in cache.txt, and the manifest for warm starts
+void write_cache_metadata(double video_duration) {
+    ScopedStatTimer stat_timer(StatId::CacheMetadataWrite);
+    std::ofstream cache_file_stream(g_current_cache_metadata_file);
+    if (cache_file_stream.is_open()) {
+        std::map<std::string, std::string> data_to_cache = g_args.to_cache_map(video_duration);
+        for (const auto& cache_pair : data_to_cache) {
+            cache_file_stream << cache_pair.first << "=" << cache_pair.second << '\n';
         }
+        cache_file_stream.close();
+    } else {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex); std::cerr << "ERROR: Failed to write cache metadata: " << g_current_cache_metadata_file << '\n';
+    }
+    write_manifest(video_duration);
+}
 
-        std::pair<std::filesystem::path, int> task;
-        bool task_ready = false;
-        {
-            std::unique_lock<std::mutex> lock(g_conversion_queue_mutex);
-            g_conversion_queue_cv.wait(lock, [] {
-                return !g_ascii_conversion_queue.empty() || g_png_processing_done.load() || g_pipeline_error_occurred.load();
-            });
-
-            if (!g_ascii_conversion_queue.empty()) {
-                task = g_ascii_conversion_queue.front();
-                g_ascii_conversion_queue.pop();
-                task_ready = true;
-            } else if (g_png_processing_done.load() || g_pipeline_error_occurred.load()) {
-                break;
+// Decode units per decoder: finished decoders claim the next unit in frame order, so one slow stretch
+// of video doesn't hold the whole build back
+constexpr int kDecodeUnitsPerDecoder = 4;
+constexpr double kMinDecodeUnitSeconds = 2.0; // Below this, FFmpeg start-up outweighs the decode
+
+// Split frames 0..total_frames-1 into unit_count runs of consecutive frames on the exact frame grid.
+// Each cut moves to the nearest keyframe_frames entry (ascending indices of the first frame at or after
+// each keyframe) within half a unit, so its decoder starts right at a keyframe instead of decoding
+// frames it then throws away; without one nearby it stays where it is. The last unit runs to the end of
+// the video.
+std::vector<RenderSegment> plan_decode_units(int total_frames, const std::vector<int>& keyframe_frames, int unit_count,
+                                             int framerate, double video_duration) {
+    std::vector<RenderSegment> units;
+    if (total_frames <= 0) return units;
+    unit_count = std::max(1, std::min(unit_count, total_frames));
+    const int half_unit = total_frames / unit_count / 2;
+    auto add_unit = [&](int base, int end) {
+        RenderSegment unit;
+        unit.base_frame = base;
+        unit.frame_count = end - base;
+        unit.start = base / static_cast<double>(framerate);
+        unit.duration = unit.frame_count / static_cast<double>(framerate);
+        units.push_back(unit);
+    };
+    int base = 0;
+    for (int i = 1; i < unit_count; ++i) {
+        const int ideal = static_cast<int>(static_cast<long long>(total_frames) * i / unit_count);
+        int cut = ideal;
+        auto it = std::lower_bound(keyframe_frames.begin(), keyframe_frames.end(), ideal - half_unit);
+        for (int best_distance = half_unit + 1; it != keyframe_frames.end() && *it <= ideal + half_unit; ++it) {
+            if (std::abs(*it - ideal) < best_distance) {
+                best_distance = std::abs(*it - ideal);
+                cut = *it;
             }
         }
+        if (cut <= base || cut >= total_frames) continue;
+        add_unit(base, cut);
+        base = cut;
+    }
+    add_unit(base, total_frames);
+    units.back().duration = std::max(units.back().duration, video_duration - units.back().start);
+    return units;
+}
+
+// Cross-Process Locks
+// Several instances often start at once for the same clip (one per terminal or tmux pane opened at
+// login). They coordinate through flock() on small lock files beside what they build: the argument
+// cache directory, the frame pack and its staging area, and the decode tier. One instance builds and
+// the others wait, then use what it built. The kernel drops a lock when its holder exits, however it
+// exits, so a crashed build never wedges the others.
+class FileLock {
+public:
+    FileLock() = default;
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    ~FileLock() { release(); }
+
+    // Take the lock if nobody holds it. Also true when the lock file can't be created (a read-only
+    // cache has nothing to coordinate), or when this object already holds it.
+    bool try_acquire(const std::filesystem::path& lock_path) {
+        if (fd_ >= 0 && lock_path == path_) return true;
+        release();
+        fd_ = ::open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd_ < 0) return true;
+        path_ = lock_path;
+        return flock(fd_, LOCK_EX | LOCK_NB) == 0;
+    }
+
+    // Wait for the lock try_acquire found taken
+    void acquire() {
+        if (fd_ < 0) return;
+        while (flock(fd_, LOCK_EX) != 0 && errno == EINTR) {}
+    }
 
-        if (task_ready) {
-            if (g_pipeline_error_occurred.load()) continue;
+    void release() {
+        if (fd_ < 0) return;
+        ::close(fd_); // Closing the only descriptor drops the lock
+        fd_ = -1;
+        path_.clear();
+    }
 
-            const auto& png_file_path = task.first;
-            std::string ascii_filename = png_file_path.stem().string() + ".txt";
-            std::filesystem::path ascii_output_path = g_processed_ascii_path / ascii_filename;
+private:
+    int fd_ = -1;
+    std::filesystem::path path_;
+};
 
-            std::string chafa_cmd = "chafa " + g_args.chafa_arguments + " --format symbols --size=" +
-                                    std::to_string(g_args.width) + "x" + std::to_string(g_args.actual_chafa_height) +
-                                    " \"" + png_file_path.string() + "\"";
+FileLock g_args_cache_lock;  // Held while g_current_args_cache_dir is (re)built
+FileLock g_frame_pack_lock;  // Held while g_frame_pack_path is rendered
+FileLock g_decode_tier_lock; // Held while this run may write g_decode_tier_path
 
-            std::string chafa_output_text = run_command_with_output_ex(chafa_cmd);
+// Lock file for a cache entry: the entry's path with ".lock" appended
+std::filesystem::path lock_path_for(const std::filesystem::path& guarded) {
+    std::filesystem::path lock_path = guarded;
+    lock_path += ".lock";
+    return lock_path;
+}
 
-            if (!chafa_output_text.empty()) {
-                std::ofstream ascii_file(ascii_output_path);
-                if (ascii_file.is_open()) {
-                    ascii_file << chafa_output_text;
-                    ascii_file.close();
-                    int count_after_increment = g_ascii_frames_completed.fetch_add(1) + 1;
-                    print_verbose("CHAFA_WORKER_DEBUG: Wrote: " + ascii_output_path.filename().string() + ". Total ASCII: " + std::to_string(count_after_increment));
-                } else {
-                    std::lock_guard<std::mutex> lock(g_cerr_mutex);
-                    std::cerr << "ERROR: ASCII Converter " << worker_id << " failed to open output file: " << ascii_output_path << '\n';
-                    g_pipeline_error_occurred.store(true);
+// Segment layout for one cache build, worked out by prepare_animation_assets
+struct AssetBuildPlan {
+    bool stream_mode = false;
+    double video_duration = 0.0;
+    unsigned int hw_threads = 1;
+    unsigned int decoder_count = 1; // Decode units run at most this many at a time
+    std::vector<std::filesystem::path> segment_dirs;
+    std::vector<int> segment_start_frame_indices;
+    std::vector<std::pair<double, double>> segment_times; // (start, duration)
+    std::vector<int> segment_frame_limits;                // Frames to decode per segment, 0 for all
+    std::vector<unsigned int> segment_ids;
+    int frames_to_convert = 0;                            // Estimate, as the final unit's frame count is one
+    bool record_metadata = true;                          // Write cache.txt and the manifest (not for pyramid levels)
+};
+
+void cleanup_on_exit();
+
+// Drop the decode outputs of a build. Converted frames and the journal stay for the next run.
+void remove_render_scratch() {
+    std::error_code ec;
+    std::filesystem::remove_all(g_temp_png_segments_path, ec);
+    std::filesystem::remove_all(g_batch_png_path, ec);
+    std::filesystem::remove_all(g_processed_png_path, ec);
+}
+
+// A progressive build runs beside the player, so restore the terminal here and leave without running
+// static destructors under the player's feet
+[[noreturn]] void exit_asset_build_failed() {
+    if (g_progressive_frames.active()) {
+        cleanup_on_exit();
+        std::_Exit(1);
+    }
+    std::exit(1);
+}
+
+// Cache-miss work after setup: decode, convert, pack, and record the cache metadata
+void build_animation_frames(const AssetBuildPlan& plan) {
+    ScopedStatTimer stat_timer(StatId::CacheBuild);
+    g_asset_build_running.store(true);
+    // One pool serves every stage: workers run decode tasks while they last and otherwise convert and
+    // commit frames, so no core sits idle behind a fixed decoder/converter split.
+    // Each decode task is a lane that claims decode units in frame order until none are left.
+    const unsigned int decode_task_count = std::min(plan.decoder_count, static_cast<unsigned int>(plan.segment_ids.size()));
+    const unsigned int pool_size = std::max(plan.hw_threads, decode_task_count + 1);
+    g_task_pool.start(pool_size);
+    g_decode_tasks_remaining.store(static_cast<int>(decode_task_count));
+    if (decode_task_count == 0) g_ffmpeg_extraction_done.store(true);
+    print_verbose("Task pool: " + std::to_string(pool_size) + " workers, " + std::to_string(decode_task_count) + " decoders for " +
+                  std::to_string(plan.segment_ids.size()) + " decode units.");
+    std::atomic<size_t> next_unit(0);
+    g_chafa_batcher.open(static_cast<size_t>(plan.frames_to_convert));
+
+    if (plan.stream_mode) {
+        // Two frames in flight per worker keeps everyone busy while bounding memory to a handful of frames
+        const size_t channels = g_args.chroma_flag_given ? 4 : 3;
+        g_raw_frame_ring.reset(pool_size * 2 + decode_task_count,
+                               static_cast<size_t>(g_stream_frame_width) * g_stream_frame_height * channels);
+        for (unsigned int lane = 0; lane < decode_task_count; ++lane) {
+            g_task_pool.submit(TaskStage::Decode, [&plan, &next_unit] {
+                for (size_t i; (i = next_unit.fetch_add(1)) < plan.segment_ids.size();) {
+                    if (g_decode_tier.is_open()) {
+                        stream_tier_range(plan.segment_ids[i], plan.segment_start_frame_indices[i] + 1,
+                                          plan.segment_start_frame_indices[i] + plan.segment_frame_limits[i]);
+                    } else {
+                        stream_video_segment(plan.segment_ids[i], plan.segment_times[i].first, plan.segment_times[i].second,
+                                             plan.segment_frame_limits[i], plan.segment_start_frame_indices[i]);
+                    }
                 }
-            } else { // Chafa output was empty
-                print_verbose("WARNING: ASCII Converter " + std::to_string(worker_id) + " got empty output from Chafa for " + png_file_path.string());
-            }
+                finish_decode_task();
+            });
         }
+    } else {
+        // Directories and watches must exist before FFmpeg starts writing into them
+        for (const auto& dir : plan.segment_dirs) std::filesystem::create_directories(dir);
+        g_png_frame_events.open(plan.segment_dirs);
+        for (unsigned int lane = 0; lane < decode_task_count; ++lane) {
+            g_task_pool.submit(TaskStage::Decode, [&plan, &next_unit] {
+                for (size_t i; (i = next_unit.fetch_add(1)) < plan.segment_ids.size();) {
+                    process_video_segment(plan.segment_ids[i], plan.segment_times[i].first, plan.segment_times[i].second,
+                                          plan.segment_frame_limits[i], plan.segment_dirs[i]);
+                }
+                finish_decode_task();
+            });
+        }
+        prepare_png_frames(plan.segment_dirs, plan.segment_start_frame_indices); // Dispatches from this thread until extraction ends
+        close_chafa_batches();
     }
-    print_verbose("ASCII Converter " + std::to_string(worker_id) + ": Finished.");
-}
 
-// Prepare all animation assets
-void prepare_animation_assets() {
-    std::filesystem::path input_file_path_obj(g_args.filename);
-    // Ensure g_args.filename is absolute for consistent hashing and path operations
-    try {
-        g_args.filename = std::filesystem::absolute(input_file_path_obj).string();
-        input_file_path_obj = g_args.filename; // update obj as well
-    } catch (const std::filesystem::filesystem_error& e) {
-        std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ERROR: Could not resolve absolute path for input file '" << g_args.filename << "': " << e.what() << '\n';
-        exit(1);
+    g_task_pool.wait_idle();
+    g_task_pool.stop();
+    g_asset_build_running.store(false);
+    g_png_frame_events.close();
+    g_render_journal.close();
+    g_decode_tier.close();
+    if (g_decode_tier_writer.active()) {
+        if (g_pipeline_error_occurred.load()) g_decode_tier_writer.abandon();
+        else g_decode_tier_written = g_decode_tier_writer.finish(plan.segment_start_frame_indices);
     }
+    print_verbose("All pipeline tasks finished.");
 
-    // Define cache paths
-    std::filesystem::path project_root_dir = std::filesystem::current_path();
-    std::filesystem::path base_cache_dir = project_root_dir / ".cache";
+    print_verbose("DEBUG_POST_CHAFA: g_ascii_frames_completed.load(): " + std::to_string(g_ascii_frames_completed.load()));
+    print_verbose("DEBUG_POST_CHAFA: g_pngs_ready_for_ascii.load(): " + std::to_string(g_pngs_ready_for_ascii.load()));
 
-    try {
-        if (!std::filesystem::exists(base_cache_dir)) {
-            std::filesystem::create_directories(base_cache_dir);
-            print_verbose("Created base cache directory: " + base_cache_dir.string());
-        }
-    } catch (const std::filesystem::filesystem_error& e) {
+    if (g_pipeline_error_occurred.load()) {
         std::lock_guard<std::mutex> lock(g_cerr_mutex);
-        std::cerr << "ERROR: Could not create base cache directory '" << base_cache_dir.string() << "': " << e.what() << '\n';
-        exit(1);
+        std::cerr << "ERROR: Asset pipeline error. Cleaning up current hash directory; the " << g_ascii_frames_completed.load()
+                  << " frames finished so far are kept and the next run resumes from them.\n";
+        if (std::filesystem::exists(g_current_args_cache_dir)) std::filesystem::remove_all(g_current_args_cache_dir);
+        remove_render_scratch();
+        exit_asset_build_failed();
     }
-    
-    g_video_specific_cache_root = base_cache_dir / input_file_path_obj.filename();
 
-    std::string current_args_hash = hash_args_map(g_args.to_input_map()); // Now includes video file identity
-    g_current_args_cache_dir = g_video_specific_cache_root / current_args_hash;
-    g_current_cache_metadata_file = g_current_args_cache_dir / "cache.txt";
-    g_processed_ascii_path = g_current_args_cache_dir / "ascii_art";
+    int frames_packed = write_frame_pack(g_frame_pack_path, g_processed_ascii_path, g_args.actual_chafa_height, g_args.width);
+    if (frames_packed < 0) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex); std::cerr << "ERROR: Could not pack ASCII frames. Cleaning up current hash directory.\n";
+        if (std::filesystem::exists(g_current_args_cache_dir)) std::filesystem::remove_all(g_current_args_cache_dir);
+        remove_render_scratch();
+        exit_asset_build_failed();
+    }
+    if (g_ascii_frames_completed.load() != frames_packed) {
+        print_verbose("WARNING: Atomic frame counter (" + std::to_string(g_ascii_frames_completed.load()) +
+                      ") differs from packed frame count (" + std::to_string(frames_packed) +
+                      "). Using packed count for cache num_frames.");
+    }
+    g_args.num_frames = frames_packed;
+    std::filesystem::remove_all(g_render_staging_path); // Per-frame files, journal and decode outputs were only a staging area
 
-    double video_file_duration = 0.0; // Will be populated either from cache or ffprobe
+    if (g_args.num_frames == 0 && plan.video_duration > 0.1) { // If no frames were produced for a valid video
+        std::lock_guard<std::mutex> lock(g_cerr_mutex); std::cerr << "ERROR: Asset generation resulted in 0 frames for a video of duration " << plan.video_duration << "s. Check logs and FFmpeg/Chafa output.\n";
+        if (std::filesystem::exists(g_current_args_cache_dir)) std::filesystem::remove_all(g_current_args_cache_dir);
+        exit_asset_build_failed();
+    }
+
+    if (plan.record_metadata) write_cache_metadata(plan.video_duration);
+    g_decode_tier_lock.release();
+    g_frame_pack_lock.release();
+    g_args_cache_lock.release();
+
+    g_progressive_frames.finish();
+}
+
+// Frame packs are shared by every parameter set (and every file name) that renders the same frames,
+// and so is the staging area a pack is built in
+std::filesystem::path frame_pack_path_for(const AnifetchArgs& args) {
+    return std::filesystem::current_path() / ".cache" / "frames" / (hash_args_map(args.to_frame_input_map()) + ".pack");
+}
 
-    if (!g_args.force_render && std::filesystem::exists(g_current_cache_metadata_file)) {
+void use_frame_pack_path(const std::filesystem::path& pack_path) {
+    g_frame_pack_path = pack_path;
+    g_render_staging_path = g_frame_pack_path;
+    g_render_staging_path.replace_extension(".render");
+    g_processed_ascii_path = g_render_staging_path / "ascii_art";
+    g_processed_png_path = g_render_staging_path / "final_pngs";
+    g_temp_png_segments_path = g_render_staging_path / "temp_png_segments";
+    g_batch_png_path = g_render_staging_path / "batch_pngs";
+}
+
+void render_frame_pack(double video_file_duration, bool record_metadata);
+bool adopt_frame_pack(double video_file_duration, bool record_metadata);
+
+// Check the cache for the current arguments, loading its derived values into g_args. video_file_duration
+// gets the cached duration, or 0 when it isn't known.
+bool load_cached_assets(double& video_file_duration) {
+    if (std::filesystem::exists(g_current_cache_metadata_file)) {
         print_verbose("DEBUG: Found existing cache metadata: " + g_current_cache_metadata_file.string());
         std::map<std::string, std::string> cached_args_map = parse_cache_txt(g_current_cache_metadata_file);
         std::map<std::string, std::string> current_input_args_map = g_args.to_input_map();
@@ -595,24 +4414,16 @@ void prepare_animation_assets() {
                 print_verbose("DEBUG: >> Error parsing derived values from cache: " + std::string(e.what())); cache_is_valid = false;
             }
 
-            if (cache_is_valid && !std::filesystem::is_directory(g_processed_ascii_path)) {
-                print_verbose("DEBUG: >> ASCII art directory missing: " + g_processed_ascii_path.string());
-                cache_is_valid = false;
-            } else if (cache_is_valid) { 
-                int frames_on_disk = 0;
-                if (std::filesystem::exists(g_processed_ascii_path)) {
-                    for (const auto& entry : std::filesystem::directory_iterator(g_processed_ascii_path)) {
-                        if (entry.is_regular_file() && entry.path().extension() == ".txt") frames_on_disk++;
-                    }
-                }
-                print_verbose("DEBUG: Frames on disk: " + std::to_string(frames_on_disk) + ", Cached num_frames: " + std::to_string(g_args.num_frames));
+            if (cache_is_valid) {
+                int frames_in_pack = read_frame_pack_count(g_frame_pack_path);
+                print_verbose("DEBUG: Frames in pack: " + std::to_string(frames_in_pack) + ", Cached num_frames: " + std::to_string(g_args.num_frames));
 
-                if (frames_on_disk != g_args.num_frames) {
-                    print_verbose("DEBUG: >> Mismatch: frames_on_disk (" + std::to_string(frames_on_disk) +
+                if (frames_in_pack != g_args.num_frames) {
+                    print_verbose("DEBUG: >> Mismatch: frames_in_pack (" + std::to_string(frames_in_pack) +
                                   ") != cached num_frames (" + std::to_string(g_args.num_frames) + ")");
                     cache_is_valid = false;
                 }
-                
+
                 if (cache_is_valid && video_file_duration <= 0.01) { // If duration wasn't in cache or was zero
                     video_file_duration = get_video_duration_ex(g_args.filename);
                 }
@@ -633,18 +4444,69 @@ void prepare_animation_assets() {
 
             if (cache_is_valid) {
                 print_verbose("Cache is valid and will be used.");
-                return; 
+                write_manifest(video_file_duration); // The next start can skip these checks
+                return true;
             } else { print_verbose("Cache invalid or incomplete. Re-rendering."); }
         } else { print_verbose("Cache input arguments mismatch (could be video file change or parameter change). Re-rendering."); }
     }
+    return false;
+}
+
+// Prepare all animation assets
+void prepare_animation_assets() {
+    std::filesystem::path input_file_path_obj(g_args.filename);
+    // Ensure g_args.filename is absolute for consistent hashing and path operations
+    try {
+        g_args.filename = std::filesystem::absolute(input_file_path_obj).string();
+        input_file_path_obj = g_args.filename; // update obj as well
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ERROR: Could not resolve absolute path for input file '" << g_args.filename << "': " << e.what() << '\n';
+        exit(1);
+    }
+
+    // Define cache paths
+    std::filesystem::path project_root_dir = std::filesystem::current_path();
+    std::filesystem::path base_cache_dir = project_root_dir / ".cache";
+
+    try {
+        if (!std::filesystem::exists(base_cache_dir)) {
+            std::filesystem::create_directories(base_cache_dir);
+            print_verbose("Created base cache directory: " + base_cache_dir.string());
+        }
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "ERROR: Could not create base cache directory '" << base_cache_dir.string() << "': " << e.what() << '\n';
+        exit(1);
+    }
+    
+    g_video_specific_cache_root = base_cache_dir / input_file_path_obj.filename();
+    g_manifest_path = manifest_path_for_args();
+    if (stat(g_args.filename.c_str(), &g_video_stat) != 0) g_video_stat = {}; // Before hashing, so a change during it isn't missed
+    g_args.video_identity = compute_video_identity(g_args.filename);
+
+    std::string current_args_hash = hash_args_map(g_args.to_input_map()); // Now includes video file identity
+    g_current_args_cache_dir = g_video_specific_cache_root / current_args_hash;
+    g_current_cache_metadata_file = g_current_args_cache_dir / "cache.txt";
+    use_frame_pack_path(frame_pack_path_for(g_args));
+    std::filesystem::create_directories(g_frame_pack_path.parent_path());
+
+    double video_file_duration = 0.0; // Will be populated either from cache or ffprobe
+
+    if (!g_args.force_render && load_cached_assets(video_file_duration)) return;
+
+    // Another instance may be building this very cache: wait for it and use what it built
+    std::filesystem::create_directories(g_video_specific_cache_root);
+    if (!g_args_cache_lock.try_acquire(lock_path_for(g_current_args_cache_dir))) {
+        std::cout << "Waiting for another anifetch to finish caching this animation...\n" << std::flush;
+        g_args_cache_lock.acquire();
+        if (!g_args.force_render && load_cached_assets(video_file_duration)) {
+            g_args_cache_lock.release();
+            return;
+        }
+    }
 
     std::cout << "Caching...\n";
-    g_pipeline_error_occurred.store(false);
-    g_ffmpeg_extraction_done.store(false);
-    g_png_processing_done.store(false);
-    g_pngs_ready_for_ascii.store(0);
-    g_ascii_frames_completed.store(0);
-    while(!g_ascii_conversion_queue.empty()) g_ascii_conversion_queue.pop();
 
     if (std::filesystem::exists(g_current_args_cache_dir)) {
          std::filesystem::remove_all(g_current_args_cache_dir);
@@ -652,12 +4514,6 @@ void prepare_animation_assets() {
     // Create_directories will create g_video_specific_cache_root if it doesn't exist.
     std::filesystem::create_directories(g_current_args_cache_dir); 
     
-    g_processed_png_path = g_current_args_cache_dir / "final_pngs";
-    g_temp_png_segments_path = g_current_args_cache_dir / "temp_png_segments";
-    std::filesystem::create_directories(g_processed_png_path);
-    std::filesystem::create_directories(g_temp_png_segments_path);
-    std::filesystem::create_directories(g_processed_ascii_path);
-
     g_args.sound_saved_path.clear();
     if (g_args.sound_flag_given) {
         if (!g_args.sound_arg.empty()) { // User provided a specific sound file
@@ -685,11 +4541,112 @@ void prepare_animation_assets() {
         }
     }
 
+    // Frames don't depend on the sound or the file name, so another parameter set may already have
+    // rendered exactly these frames
+    if (!g_args.force_render && adopt_frame_pack(video_file_duration, true)) return;
+
+    render_frame_pack(video_file_duration, true);
+}
+
+// Use the frame pack already at g_frame_pack_path instead of rendering it, and drop the build locks
+bool adopt_frame_pack(double video_file_duration, bool record_metadata) {
+    FramePack existing_pack;
+    if (!existing_pack.open(g_frame_pack_path) || existing_pack.frame_count() == 0 || existing_pack.rows() <= 0) return false;
+    g_args.actual_chafa_height = existing_pack.rows();
+    g_args.num_frames = static_cast<int>(existing_pack.frame_count());
+    if (record_metadata) {
+        if (video_file_duration <= 0.01) video_file_duration = get_video_duration_ex(g_args.filename);
+        write_cache_metadata(video_file_duration);
+    }
+    print_verbose("Reusing " + std::to_string(g_args.num_frames) + " frames from " + g_frame_pack_path.string());
+    g_frame_pack_lock.release();
+    g_args_cache_lock.release();
+    return true;
+}
+
+// Render the frame pack at g_frame_pack_path for the current width and height. video_file_duration
+// is probed when it isn't known yet (0).
+void render_frame_pack(double video_file_duration, bool record_metadata) {
+    // Other parameter sets share this pack and its staging area, so only one instance renders it
+    if (!g_frame_pack_lock.try_acquire(lock_path_for(g_frame_pack_path))) {
+        std::cout << "Waiting for another anifetch to finish rendering these frames...\n" << std::flush;
+        g_frame_pack_lock.acquire();
+        if (!g_args.force_render && adopt_frame_pack(video_file_duration, record_metadata)) return;
+    }
+
+    g_pipeline_error_occurred.store(false);
+    g_ffmpeg_extraction_done.store(false);
+    g_pngs_ready_for_ascii.store(0);
+    g_ascii_frames_completed.store(0);
+    if (g_args.force_render) {
+        std::error_code ec;
+        std::filesystem::remove_all(g_render_staging_path, ec);
+    }
+    remove_render_scratch(); // Decode outputs of an interrupted run are not worth checking
+    if (g_args.decode_mode == "png") {
+        std::filesystem::create_directories(g_processed_png_path);
+        std::filesystem::create_directories(g_temp_png_segments_path);
+    } else if (g_args.renderer == "chafa" && g_args.chafa_batch > 1) {
+        std::filesystem::create_directories(g_batch_png_path); // Chafa reads one image from stdin, a batch from files
+    }
+    std::filesystem::create_directories(g_processed_ascii_path);
+
+    const bool stream_mode = (g_args.decode_mode == "stream");
+    if (stream_mode) {
+        int video_width = 0, video_height = 0;
+        if (!probe_video_dimensions(g_args.filename, video_width, video_height)) {
+            std::lock_guard<std::mutex> lock(g_cerr_mutex); std::cerr << "ERROR: Cannot stream frames without the video dimensions. Aborting.\n";
+            if (std::filesystem::exists(g_current_args_cache_dir)) std::filesystem::remove_all(g_current_args_cache_dir);
+            exit(1);
+        }
+        if (g_args.decode_cache) {
+            // One tier per width bucket: narrower renders in the bucket scale its frames down themselves
+            const int channels = g_args.chroma_flag_given ? 4 : 3;
+            const int tier_width = std::min(video_width, g_args.decode_cache_width());
+            const int tier_height = std::max(1, static_cast<int>(std::lround(static_cast<double>(video_height) * tier_width / video_width)));
+            std::map<std::string, std::string> tier_inputs;
+            tier_inputs["video_file_identity"] = g_args.video_identity;
+            tier_inputs["framerate"] = std::to_string(g_args.framerate);
+            tier_inputs["chroma_arg"] = g_args.chroma_arg;
+            tier_inputs["width"] = std::to_string(tier_width);
+            tier_inputs["channels"] = std::to_string(channels);
+            g_decode_tier_path = std::filesystem::current_path() / ".cache" / "decoded" / (hash_args_map(tier_inputs) + ".frames");
+            std::filesystem::create_directories(g_decode_tier_path.parent_path());
+            bool tier_open = (!g_args.force_render || g_decode_tier_written) && g_decode_tier.open(g_decode_tier_path, channels);
+            if (!tier_open && !g_decode_tier_lock.try_acquire(lock_path_for(g_decode_tier_path))) {
+                // Another instance is decoding this video into the tier; its frames beat decoding them again
+                std::cout << "Waiting for another anifetch to finish decoding this video...\n" << std::flush;
+                g_decode_tier_lock.acquire();
+                tier_open = g_decode_tier.open(g_decode_tier_path, channels);
+            }
+            if (tier_open) {
+                g_decode_tier_lock.release();
+                g_stream_frame_width = g_decode_tier.width();
+                g_stream_frame_height = g_decode_tier.height();
+                print_verbose("Decode cache: " + std::to_string(g_decode_tier.frame_count()) + " frames in " + g_decode_tier_path.string());
+            } else {
+                DecodeTierWriter::remove_stale_parts(g_decode_tier_path);
+                g_stream_frame_width = tier_width;
+                g_stream_frame_height = tier_height;
+            }
+        } else {
+            compute_stream_frame_size(video_width, video_height, g_stream_frame_width, g_stream_frame_height);
+        }
+        print_verbose("Streaming frames at " + std::to_string(g_stream_frame_width) + "x" + std::to_string(g_stream_frame_height) +
+                      " (source " + std::to_string(video_width) + "x" + std::to_string(video_height) + ")");
+    }
+
+    const bool decode_tier_was_open = g_decode_tier.is_open();
     if (!predetermine_actual_chafa_height() && g_pipeline_error_occurred.load()) {
          std::cerr << "CRITICAL: Failed to predetermine Chafa height. Aborting.\n";
          if (std::filesystem::exists(g_current_args_cache_dir)) std::filesystem::remove_all(g_current_args_cache_dir);
          exit(1);
     }
+    if (decode_tier_was_open && !g_decode_tier.is_open()) {
+        // The tier turned out damaged: this run decodes with FFmpeg and writes it again, once no other instance is
+        if (!g_decode_tier_lock.try_acquire(lock_path_for(g_decode_tier_path))) g_decode_tier_lock.acquire();
+        DecodeTierWriter::remove_stale_parts(g_decode_tier_path);
+    }
 
     if (video_file_duration <= 0.01) { // If not loaded from cache
         video_file_duration = get_video_duration_ex(g_args.filename);
@@ -702,122 +4659,183 @@ void prepare_animation_assets() {
 
     unsigned int num_hw_threads = std::thread::hardware_concurrency();
     if (num_hw_threads == 0) num_hw_threads = 2; // Fallback if detection fails
+    if (g_args.threads > 0) num_hw_threads = static_cast<unsigned int>(g_args.threads);
     // Limit ffmpeg processors to prevent excessive segmentation for short videos, but ensure at least 1.
     unsigned int num_ffmpeg_processors = std::max(1u, num_hw_threads > 1 ? num_hw_threads / 2 : 1u);
     num_ffmpeg_processors = std::min(num_ffmpeg_processors, static_cast<unsigned int>(std::ceil(video_file_duration / 1.0))); // At most 1 processor per 1s of video
     num_ffmpeg_processors = std::max(1u, num_ffmpeg_processors); // Ensure at least one
-    double segment_len_nominal = video_file_duration / num_ffmpeg_processors;
-
-    std::vector<std::filesystem::path> temp_segment_dirs;
-    std::vector<int> segment_start_frame_indices;
-    int current_ideal_frame_offset = 0;
-    std::vector<std::thread> ffmpeg_processing_threads;
-
-    for (unsigned int i = 0; i < num_ffmpeg_processors; ++i) {
-        double seg_start_time = i * segment_len_nominal;
-        double seg_duration = (i == num_ffmpeg_processors - 1) ? (video_file_duration - seg_start_time) : segment_len_nominal;
-        // Avoid creating tiny segments unless it's the very last one and is all that's left.
-        if (seg_duration < 0.1 && i < num_ffmpeg_processors - 1) continue; 
-        if (seg_duration <= 0) continue; // Skip zero or negative duration segments
 
-        std::filesystem::path segment_output_path = g_temp_png_segments_path / ("segment_" + std::to_string(i));
-        temp_segment_dirs.push_back(segment_output_path);
-        segment_start_frame_indices.push_back(current_ideal_frame_offset);
-
-        ffmpeg_processing_threads.emplace_back(process_video_segment, i, seg_start_time, seg_duration, segment_output_path);
-        current_ideal_frame_offset += static_cast<int>(std::round(seg_duration * g_args.framerate));
+    // Cut the frame grid into decode units, at keyframes where there are any nearby, so seeking decoders
+    // don't decode frames they throw away. A frame pack built from the decode cache cuts at its keyframes.
+    int current_ideal_frame_offset = static_cast<int>(std::lround(video_file_duration * g_args.framerate));
+    std::vector<int> keyframe_frames;
+    if (g_decode_tier.is_open()) {
+        current_ideal_frame_offset = g_decode_tier.frame_count(); // The tier knows exactly how many frames there are
+        for (int frame = 1; frame < current_ideal_frame_offset; ++frame) {
+            if (g_decode_tier.keyframe_for(frame + 1) == frame + 1) keyframe_frames.push_back(frame);
+        }
+    } else {
+        for (double keyframe_time : probe_keyframe_times(g_args.filename)) {
+            const int frame = static_cast<int>(std::ceil(keyframe_time * g_args.framerate - 1e-6));
+            if (frame > 0 && (keyframe_frames.empty() || frame > keyframe_frames.back())) keyframe_frames.push_back(frame);
+        }
     }
-
-    std::thread png_preparer_thread(prepare_png_frames, temp_segment_dirs, segment_start_frame_indices);
-
-    unsigned int ffmpeg_threads_actual_count = static_cast<unsigned int>(ffmpeg_processing_threads.size());
-    unsigned int ascii_converter_candidate_threads = 1u; // Default to 1
-    if (num_hw_threads > ffmpeg_threads_actual_count && ffmpeg_threads_actual_count > 0) {
-        ascii_converter_candidate_threads = num_hw_threads - ffmpeg_threads_actual_count;
-    } else if (num_hw_threads <= ffmpeg_threads_actual_count && num_hw_threads > 0) {
-         ascii_converter_candidate_threads = 1u; // If ffmpeg takes all/most, still use 1 for chafa
+    // A whole number of units per decoder keeps the decoders evenly loaded
+    const int min_unit_frames = std::max(1, static_cast<int>(std::lround(g_args.framerate * kMinDecodeUnitSeconds)));
+    const int units_per_decoder = std::clamp(current_ideal_frame_offset / (static_cast<int>(num_ffmpeg_processors) * min_unit_frames),
+                                             1, kDecodeUnitsPerDecoder);
+    std::vector<RenderSegment> layout = plan_decode_units(current_ideal_frame_offset, keyframe_frames,
+                                                          static_cast<int>(num_ffmpeg_processors) * units_per_decoder,
+                                                          g_args.framerate, video_file_duration);
+    print_verbose("Planned " + std::to_string(layout.size()) + " decode units over " + std::to_string(current_ideal_frame_offset) +
+                  " frames (" + std::to_string(keyframe_frames.size()) + " keyframes).");
+
+    // Resume an interrupted build of these frames: keep its layout, so frame numbers line up, and its
+    // verified frames
+    const std::filesystem::path journal_path = g_render_staging_path / "journal";
+    std::vector<RenderSegment> journal_layout;
+    std::set<int> completed_frames;
+    bool journal_open = false;
+    if (RenderJournal::load(journal_path, g_processed_ascii_path, g_args.actual_chafa_height, journal_layout, completed_frames)) {
+        layout = std::move(journal_layout);
+        current_ideal_frame_offset = 0;
+        for (const auto& segment : layout) current_ideal_frame_offset = std::max(current_ideal_frame_offset, segment.base_frame + segment.frame_count);
+        journal_open = g_render_journal.reopen(journal_path);
+        std::cout << "Resuming: " << completed_frames.size() << " of " << current_ideal_frame_offset << " frames already rendered.\n";
+    } else {
+        std::error_code ec;
+        std::filesystem::remove_all(g_processed_ascii_path, ec); // Frames without a journal can't be trusted
+        std::filesystem::create_directories(g_processed_ascii_path);
+        journal_open = g_render_journal.create(journal_path, g_args.actual_chafa_height, layout);
     }
-    // Ensure at least 1 chafa converter
-    unsigned int num_ascii_converters = std::max(1u, std::min(ascii_converter_candidate_threads, num_hw_threads > 1 ? num_hw_threads / 2 : 1u) );
-    num_ascii_converters = std::max(1u, num_ascii_converters);
-
-
-    std::vector<std::thread> ascii_conversion_threads;
-    for (unsigned int i = 0; i < num_ascii_converters; ++i) ascii_conversion_threads.emplace_back(convert_png_to_ascii, i);
-
-    for (auto& th : ffmpeg_processing_threads) if (th.joinable()) th.join();
-    g_ffmpeg_extraction_done.store(true);
-    g_conversion_queue_cv.notify_all(); // Wake up PNG preparer and ASCII converters
-
-    if (png_preparer_thread.joinable()) png_preparer_thread.join();
-    // g_png_processing_done is set by png_preparer_thread itself.
-    g_conversion_queue_cv.notify_all(); // Wake up ASCII converters one last time
-
-    for (auto& th : ascii_conversion_threads) if (th.joinable()) th.join();
-    print_verbose("All conversion threads joined.");
-
-    #if defined(__linux__) || defined(__APPLE__)
-        print_verbose("DEBUG_POST_CHAFA: Calling sync()...");
-        sync();
-        print_verbose("DEBUG_POST_CHAFA: sync() done.");
-    #endif
-
-    int frames_on_disk_after_sync = 0;
-    if (std::filesystem::exists(g_processed_ascii_path) && std::filesystem::is_directory(g_processed_ascii_path)) {
-        for (const auto& entry : std::filesystem::directory_iterator(g_processed_ascii_path)) {
-            if (entry.is_regular_file() && entry.path().extension() == ".txt") {
-                frames_on_disk_after_sync++;
+    if (!journal_open) {
+        std::lock_guard<std::mutex> lock(g_cerr_mutex);
+        std::cerr << "Warning: Could not write the render journal " << journal_path << "; an interrupted render will start over.\n";
+    }
+    g_ascii_frames_completed.store(static_cast<int>(completed_frames.size()));
+
+    // Decode each run of missing frames on its own, stopping after its last frame. A run that ends the
+    // final unit decodes to the end of the video.
+    AssetBuildPlan plan;
+    plan.stream_mode = stream_mode;
+    plan.video_duration = video_file_duration;
+    plan.hw_threads = num_hw_threads;
+    plan.decoder_count = num_ffmpeg_processors;
+    plan.frames_to_convert = current_ideal_frame_offset - static_cast<int>(completed_frames.size());
+    plan.record_metadata = record_metadata;
+    for (const auto& segment : layout) {
+        int run_first = 0; // Local index of the first missing frame of the current run, 0 when none
+        for (int local = 1; local <= segment.frame_count + 1; ++local) {
+            const bool missing = local <= segment.frame_count && !completed_frames.count(segment.base_frame + local);
+            if (missing && run_first == 0) run_first = local;
+            if (missing || run_first == 0) continue;
+            const bool to_segment_end = local > segment.frame_count;
+            const double run_start = segment.start + (run_first - 1) / static_cast<double>(g_args.framerate);
+            const unsigned int range_id = static_cast<unsigned int>(plan.segment_ids.size());
+            plan.segment_dirs.push_back(g_temp_png_segments_path / ("segment_" + std::to_string(range_id)));
+            plan.segment_start_frame_indices.push_back(segment.base_frame + run_first - 1);
+            plan.segment_times.push_back({run_start, to_segment_end ? segment.start + segment.duration - run_start
+                                                                    : (local - run_first) / static_cast<double>(g_args.framerate)});
+            // Only the final unit's frame count is an estimate; it decodes to the end of the video (or of the decode cache)
+            int frame_limit = local - run_first;
+            if (to_segment_end && &segment == &layout.back()) {
+                frame_limit = g_decode_tier.is_open() ? g_decode_tier.frame_count() - (segment.base_frame + run_first) + 1 : 0;
             }
+            plan.segment_frame_limits.push_back(frame_limit);
+            plan.segment_ids.push_back(range_id);
+            run_first = 0;
         }
     }
-    print_verbose("DEBUG_POST_CHAFA: Frames on disk (after sync): " + std::to_string(frames_on_disk_after_sync));
-    print_verbose("DEBUG_POST_CHAFA: g_ascii_frames_completed.load(): " + std::to_string(g_ascii_frames_completed.load()));
-    print_verbose("DEBUG_POST_CHAFA: g_pngs_ready_for_ascii.load(): " + std::to_string(g_pngs_ready_for_ascii.load()));
-
-
-    if (g_pipeline_error_occurred.load()) {
-        std::lock_guard<std::mutex> lock(g_cerr_mutex); std::cerr << "ERROR: Asset pipeline error. Cleaning up current hash directory.\n";
-        if (std::filesystem::exists(g_current_args_cache_dir)) std::filesystem::remove_all(g_current_args_cache_dir);
-        exit(1);
-    }
-    
-    // Use the more reliable disk count if it differs from atomic counter, though they should ideally match.
-    if (g_ascii_frames_completed.load() != frames_on_disk_after_sync && frames_on_disk_after_sync > 0) {
-        print_verbose("WARNING: Atomic frame counter (" + std::to_string(g_ascii_frames_completed.load()) +
-                      ") differs from final disk count (" + std::to_string(frames_on_disk_after_sync) +
-                      "). Using disk count for cache num_frames.");
-        g_args.num_frames = frames_on_disk_after_sync;
-    } else {
-        g_args.num_frames = g_ascii_frames_completed.load();
+    if (!completed_frames.empty()) print_verbose("Render journal: decoding " + std::to_string(plan.segment_ids.size()) + " missing frame ranges.");
+    // Only a complete decode of the whole video becomes a tier
+    if (stream_mode && g_args.decode_cache && !g_decode_tier.is_open() && completed_frames.empty()) {
+        g_decode_tier_writer.begin(g_decode_tier_path, g_stream_frame_width, g_stream_frame_height,
+                                   g_args.chroma_flag_given ? 4 : 3, plan.segment_ids.size());
     }
 
+    if (g_args.progressive_frames <= 0) {
+        build_animation_frames(plan);
+        return;
+    }
 
-    if (g_args.num_frames == 0 && video_file_duration > 0.1) { // If no frames were produced for a valid video
-        std::lock_guard<std::mutex> lock(g_cerr_mutex); std::cerr << "ERROR: Asset generation resulted in 0 frames for a video of duration " << video_file_duration << "s. Check logs and FFmpeg/Chafa output.\n";
-        if (std::filesystem::exists(g_current_args_cache_dir)) std::filesystem::remove_all(g_current_args_cache_dir);
-        exit(1);
+    // Progressive: keep building in the background and return once the first frames are ready
+    g_progressive_frames.start(static_cast<size_t>(std::max(0, current_ideal_frame_offset)));
+    for (int frame_number : completed_frames) { // Frames kept from an interrupted run are ready now
+        std::ifstream frame_file(g_processed_ascii_path / RenderJournal::frame_file_name(frame_number), std::ios::binary);
+        g_progressive_frames.publish(frame_number, std::string((std::istreambuf_iterator<char>(frame_file)), std::istreambuf_iterator<char>()));
     }
+    std::thread(build_animation_frames, std::move(plan)).detach();
+    const size_t frames_needed = static_cast<size_t>(g_args.progressive_frames);
+    while (!g_progressive_frames.wait_for_frames(frames_needed, std::chrono::milliseconds(100)) &&
+           !g_progressive_frames.complete() && !g_pipeline_error_occurred.load()) {}
+    print_verbose("Progressive playback starting with " + std::to_string(g_progressive_frames.ready_prefix()) + " frames ready.");
+}
 
-    if (std::filesystem::exists(g_temp_png_segments_path)) std::filesystem::remove_all(g_temp_png_segments_path);
-    if (std::filesystem::exists(g_processed_png_path) && g_args.num_frames > 0) { // Clean up final PNGs if ASCII frames exist
-         std::filesystem::remove_all(g_processed_png_path);
-         print_verbose("Cleaned up final PNGs directory: " + g_processed_png_path.string());
+// Frame Pyramid
+// With --pyramid the clip is also rendered at each listed width, with --vertical scaled to match, so
+// playback can switch to the level that best fits a resized terminal. All levels read the same
+// decoded-frame tier, which means FFmpeg decodes the video once for the whole pyramid.
+AnifetchArgs pyramid_level_args(const AnifetchArgs& primary, int level_width) {
+    AnifetchArgs level = primary;
+    level.width = level_width;
+    level.height_arg = std::max(1, static_cast<int>(std::lround(static_cast<double>(primary.height_arg) * level_width / primary.width)));
+    return level;
+}
+
+// Render the levels whose frame pack is missing, once the --horizontal pack is in place
+void render_pyramid_levels() {
+    const AnifetchArgs primary = g_args;
+    const std::filesystem::path primary_pack_path = g_frame_pack_path;
+    for (int level_width : primary.pyramid_widths) {
+        if (level_width == primary.width) continue;
+        g_args = pyramid_level_args(primary, level_width);
+        use_frame_pack_path(frame_pack_path_for(g_args));
+        if (!g_args.force_render && read_frame_pack_count(g_frame_pack_path) > 0) continue;
+        std::cout << "Caching pyramid level " << g_args.width << "x" << g_args.height_arg << "...\n";
+        render_frame_pack(0.0, false);
     }
+    g_args = primary;
+    use_frame_pack_path(primary_pack_path);
+}
 
+struct PyramidLevel {
+    int width;
+    int rows;
+    std::filesystem::path pack_path;
+};
 
-    std::ofstream cache_file_stream(g_current_cache_metadata_file);
-    if (cache_file_stream.is_open()) {
-        std::map<std::string, std::string> data_to_cache = g_args.to_cache_map(video_file_duration);
-        for (const auto& cache_pair : data_to_cache) {
-            cache_file_stream << cache_pair.first << "=" << cache_pair.second << '\n';
-        }
-        cache_file_stream.close();
-    } else {
-        std::lock_guard<std::mutex> lock(g_cerr_mutex); std::cerr << "ERROR: Failed to write cache metadata: " << g_current_cache_metadata_file << '\n';
+// Levels playback can switch to, narrowest first. Levels without a usable pack are left out.
+std::vector<PyramidLevel> collect_pyramid_levels() {
+    std::vector<PyramidLevel> levels = {{g_args.width, g_args.actual_chafa_height, g_frame_pack_path}};
+    for (int level_width : g_args.pyramid_widths) {
+        if (level_width == g_args.width) continue;
+        const std::filesystem::path pack_path = frame_pack_path_for(pyramid_level_args(g_args, level_width));
+        FramePack pack;
+        if (pack.open(pack_path) && pack.frame_count() > 0) levels.push_back({level_width, pack.rows(), pack_path});
+        else print_verbose("Pyramid level " + std::to_string(level_width) + " has no frame pack at " + pack_path.string() + "; skipping it.");
     }
+    std::sort(levels.begin(), levels.end(), [](const PyramidLevel& a, const PyramidLevel& b) { return a.width < b.width; });
+    return levels;
 }
 
 // Argument Parsing & UI Functions
+// "4096", "512K", "16M", "1G" (binary multiples) -> bytes
+bool parse_byte_size(const std::string& text, size_t& bytes) {
+    size_t digits = 0;
+    while (digits < text.size() && std::isdigit(static_cast<unsigned char>(text[digits]))) digits++;
+    if (digits == 0 || digits > 12) return false;
+    size_t value = std::stoull(text.substr(0, digits));
+    std::string suffix = text.substr(digits);
+    int shift = 0;
+    if (suffix == "K" || suffix == "k") shift = 10;
+    else if (suffix == "M" || suffix == "m") shift = 20;
+    else if (suffix == "G" || suffix == "g") shift = 30;
+    else if (!suffix.empty()) return false;
+    if (value > (SIZE_MAX >> shift)) return false; // Would overflow size_t
+    bytes = value << shift;
+    return true;
+}
+
 void parse_arguments(int argc, char* argv[]) {
     for (int i = 1; i < argc; ++i) {
         std::string arg = argv[i];
@@ -836,28 +4854,326 @@ void parse_arguments(int argc, char* argv[]) {
             g_args.sound_flag_given = true;
             if (i + 1 < argc && argv[i+1][0] != '-') g_args.sound_arg = argv[++i]; else g_args.sound_arg = ""; // "" means extract
         } else if (arg == "--force-render") g_args.force_render = true;
+        else if (arg == "--full-redraw") g_args.full_redraw = true;
+        else if (arg == "--render-only") g_args.render_only = true;
+        else if (arg == "--daemon") g_args.daemon = true;
+        else if (arg == "--connect") g_args.connect = true;
+        else if (arg == "--socket") {
+            if (i + 1 < argc) g_args.socket_path = argv[++i]; else { std::cerr << "Error: --socket requires an argument.\n"; exit(1); }
+        }
+        else if (arg == "--stats") g_args.stats = true;
+        else if (arg == "--stats-json") {
+            if (i + 1 < argc) g_args.stats_json_path = argv[++i]; else { std::cerr << "Error: --stats-json requires an argument.\n"; exit(1); }
+        }
+        else if (arg == "--retain-frames") g_args.retain_frames = true;
+        else if (arg == "--info-ttl") {
+            if (i + 1 < argc) g_args.info_ttl = std::stod(argv[++i]); else { std::cerr << "Error: --info-ttl requires an argument.\n"; exit(1); }
+        }
+        else if (arg == "--info-refresh") {
+            if (i + 1 < argc) g_args.info_refresh = std::stod(argv[++i]); else { std::cerr << "Error: --info-refresh requires an argument.\n"; exit(1); }
+        }
+        else if (arg == "--decode-cache") g_args.decode_cache = true;
+        else if (arg == "--pyramid") {
+            if (i + 1 >= argc) { std::cerr << "Error: --pyramid requires an argument.\n"; exit(1); }
+            std::istringstream widths(argv[++i]);
+            for (std::string level_width; std::getline(widths, level_width, ',');) g_args.pyramid_widths.push_back(std::stoi(level_width));
+        }
+        else if (arg == "--memory-budget") {
+            if (i + 1 < argc) g_args.memory_budget = argv[++i]; else { std::cerr << "Error: --memory-budget requires an argument.\n"; exit(1); }
+        }
+        else if (arg == "--threads") {
+            if (i + 1 < argc) g_args.threads = std::stoi(argv[++i]); else { std::cerr << "Error: --threads requires an argument.\n"; exit(1); }
+        }
+        else if (arg == "--progressive") {
+            g_args.progressive_frames = -1; // Resolved to the default below
+            if (i + 1 < argc && std::isdigit(static_cast<unsigned char>(argv[i+1][0]))) g_args.progressive_frames = std::stoi(argv[++i]);
+        }
         else if (arg == "--chafa-arguments") {
             if (i + 1 < argc) g_args.chafa_arguments = argv[++i]; else { std::cerr << "Error: --chafa-arguments requires an argument.\n"; exit(1); }
+        } else if (arg == "--chafa-batch") {
+            if (i + 1 < argc) g_args.chafa_batch = std::stoi(argv[++i]); else { std::cerr << "Error: --chafa-batch requires an argument.\n"; exit(1); }
+        } else if (arg == "--sync-update") {
+            if (i + 1 < argc) g_args.sync_update = argv[++i]; else { std::cerr << "Error: --sync-update requires an argument.\n"; exit(1); }
+        } else if (arg == "--decode-mode") {
+            if (i + 1 < argc) g_args.decode_mode = argv[++i]; else { std::cerr << "Error: --decode-mode requires an argument.\n"; exit(1); }
+        } else if (arg == "--color-depth") {
+            if (i + 1 < argc) g_args.color_depth = argv[++i]; else { std::cerr << "Error: --color-depth requires an argument.\n"; exit(1); }
+        } else if (arg == "--renderer") {
+            if (i + 1 < argc) g_args.renderer = argv[++i]; else { std::cerr << "Error: --renderer requires an argument.\n"; exit(1); }
         } else if (arg == "--chroma") {
             g_args.chroma_flag_given = true;
             if (i + 1 < argc && argv[i+1][0] != '-') g_args.chroma_arg = argv[++i]; else { std::cerr << "Chroma requires hex color argument (e.g., 0x00FF00).\n"; exit(1); }
         } else { std::cerr << "Unknown arg: " << arg << '\n'; exit(1); }
     }
-    if (g_args.filename.empty()) { std::cerr << "Filename required (--file <path>).\n"; exit(1); }
+    if (g_args.filename.empty() && !g_args.daemon) { std::cerr << "Filename required (--file <path>).\n"; exit(1); }
+    if (g_args.daemon && g_args.connect) {std::cerr << "Error: --daemon and --connect can't be combined.\n"; exit(1);}
+    if (g_args.socket_path.empty()) {
+        const char* runtime_dir = std::getenv("XDG_RUNTIME_DIR");
+        g_args.socket_path = (runtime_dir && *runtime_dir) ? std::string(runtime_dir) + "/anifetch.sock" : "/tmp/anifetch-" + std::to_string(getuid()) + ".sock";
+    }
+    if (g_args.socket_path.size() >= sizeof(sockaddr_un::sun_path)) {std::cerr << "Error: --socket path is too long for a Unix socket.\n"; exit(1);}
     if (g_args.chroma_flag_given && (g_args.chroma_arg.length() < 3 || g_args.chroma_arg.rfind("0x", 0) != 0)) { std::cerr << "Chroma hex needs '0x' prefix (e.g., 0x00FF00).\n"; exit(1); }
+    if (g_args.sync_update != "auto" && g_args.sync_update != "on" && g_args.sync_update != "off") {std::cerr << "Error: --sync-update must be 'auto', 'on' or 'off'.\n"; exit(1);}
+    if (g_args.decode_mode != "stream" && g_args.decode_mode != "png") {std::cerr << "Error: --decode-mode must be 'stream' or 'png'.\n"; exit(1);}
+    if (g_args.renderer != "auto" && g_args.renderer != "native" && g_args.renderer != "chafa") {std::cerr << "Error: --renderer must be 'auto', 'native' or 'chafa'.\n"; exit(1);}
+    if (g_args.color_depth == "auto") {
+        // COLORTERM is how terminals announce truecolor; without it, go by the 256-colour TERM names
+        const char* colorterm = std::getenv("COLORTERM");
+        const char* term = std::getenv("TERM");
+        if (colorterm && (std::string(colorterm) == "truecolor" || std::string(colorterm) == "24bit")) g_args.color_depth = "truecolor";
+        else if (term && std::string(term).find("256color") != std::string::npos) g_args.color_depth = "256";
+        else g_args.color_depth = "16";
+        print_verbose("Colour depth: " + g_args.color_depth + " (auto)");
+    }
+    if (g_args.color_depth == "256") g_color_depth = ColorDepth::Palette256;
+    else if (g_args.color_depth == "16") g_color_depth = ColorDepth::Palette16;
+    else if (g_args.color_depth != "truecolor") {std::cerr << "Error: --color-depth must be 'truecolor', '256', '16' or 'auto'.\n"; exit(1);}
+    g_args.chafa_arguments = normalize_chafa_arguments(g_args.chafa_arguments);
+    if (!split_shell_words(g_args.chafa_arguments, g_chafa_argument_words)) {std::cerr << "Error: --chafa-arguments has an unterminated quote.\n"; exit(1);}
+    bool native_style_supported = parse_native_render_style(g_args.chafa_arguments, g_native_style);
+    if (g_args.renderer == "native" && (g_args.decode_mode != "stream" || !native_style_supported)) {
+        std::cerr << "Error: --renderer native needs --decode-mode stream and --chafa-arguments limited to --symbols ascii|block|half, --fg-only and --colors full|none.\n"; exit(1);
+    }
+    if (g_args.renderer == "auto") g_args.renderer = (g_args.decode_mode == "stream" && native_style_supported) ? "native" : "chafa";
+    if (g_args.decode_cache && g_args.decode_mode != "stream") {std::cerr << "Error: --decode-cache needs --decode-mode stream.\n"; exit(1);}
     if (g_args.width <= 0) {std::cerr << "Error: --horizontal (width) must be positive.\n"; exit(1);}
     if (g_args.height_arg <= 0) {std::cerr << "Error: --vertical (height) must be positive.\n"; exit(1);}
+    if (!g_args.pyramid_widths.empty()) {
+        if (g_args.decode_mode != "stream") {std::cerr << "Error: --pyramid needs --decode-mode stream.\n"; exit(1);}
+        if (g_args.progressive_frames != 0) {std::cerr << "Error: --pyramid can't be combined with --progressive.\n"; exit(1);}
+        if (*std::min_element(g_args.pyramid_widths.begin(), g_args.pyramid_widths.end()) <= 0) {std::cerr << "Error: --pyramid widths must be positive.\n"; exit(1);}
+        g_args.pyramid_widths.push_back(g_args.width);
+        std::sort(g_args.pyramid_widths.begin(), g_args.pyramid_widths.end());
+        g_args.pyramid_widths.erase(std::unique(g_args.pyramid_widths.begin(), g_args.pyramid_widths.end()), g_args.pyramid_widths.end());
+        g_args.decode_cache = true; // Every level reads the one decoded-frame tier
+    }
     if (g_args.framerate <= 0) {std::cerr << "Error: --framerate must be positive.\n"; exit(1);}
     if (g_args.playback_rate <= 0) {std::cerr << "Error: --playback-rate must be positive.\n"; exit(1);}
+    if (g_args.info_ttl < 0) {std::cerr << "Error: --info-ttl must not be negative.\n"; exit(1);}
+    if (g_args.info_refresh < 0) {std::cerr << "Error: --info-refresh must not be negative.\n"; exit(1);}
+    g_stats_enabled = g_args.stats || !g_args.stats_json_path.empty();
+    if (g_args.threads < 0) {std::cerr << "Error: --threads must not be negative.\n"; exit(1);}
+    if (g_args.chafa_batch <= 0) {std::cerr << "Error: --chafa-batch must be positive.\n"; exit(1);}
+    if (!parse_byte_size(g_args.memory_budget, g_args.memory_budget_bytes)) {
+        std::cerr << "Error: --memory-budget must be a byte count, optionally with a K, M or G suffix (e.g. 16M).\n"; exit(1);
+    }
+    if (g_args.progressive_frames < 0) g_args.progressive_frames = g_args.framerate; // About one second of frames
+    if (g_args.render_only) g_args.progressive_frames = 0; // Nothing to play while rendering
 }
 
 void clear_screen() { std::cout << "\033[H\033[2J" << std::flush; }
-void move_cursor(int row, int col) { std::cout << "\033[" << row << ";" << col << "H" << std::flush; }
 void hide_cursor() { std::cout << "\033[?25l" << std::flush; }
 void show_cursor() { std::cout << "\033[?25h" << std::flush; }
 
+// Frame Output
+// Each frame (cursor moves, line payloads and padding) is composed into one reusable buffer and
+// handed to the terminal with a single write(), wrapped in DEC mode 2026 synchronized-update
+// markers when the terminal supports them so it never shows a half-drawn frame.
+bool g_sync_update_enabled = false;
+
+void append_cursor_move(std::string& out, int row, int col) {
+    char num[16];
+    out += "\033[";
+    out.append(num, std::to_chars(num, num + sizeof(num), row).ptr);
+    out += ';';
+    out.append(num, std::to_chars(num, num + sizeof(num), col).ptr);
+    out += 'H';
+}
+
+// write() until everything is out, riding over EINTR and short writes
+bool write_all(int fd, const char* data, size_t len) {
+    while (len > 0) {
+        ssize_t written = ::write(fd, data, len);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                struct pollfd pfd = {fd, POLLOUT, 0};
+                poll(&pfd, 1, 100);
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        len -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+void begin_frame(std::string& frame_buffer) {
+    frame_buffer.clear();
+    if (g_sync_update_enabled) frame_buffer += "\033[?2026h";
+}
+
+void submit_frame(std::string& frame_buffer) {
+    if (g_sync_update_enabled) frame_buffer += "\033[?2026l";
+    std::cout.flush(); // Anything still buffered in std::cout must land before the frame
+    write_all(STDOUT_FILENO, frame_buffer.data(), frame_buffer.size());
+}
+
+// Frame Pacing
+// A frame is only shown once the terminal has drained it, which over a slow link can take longer than
+// the frame interval. The pacer keeps an estimate of the link's drain rate, taken from writes that
+// blocked (the kernel buffer was full, so the frame went out at the link's pace) and, on ttys that
+// report it, from the output queue (TIOCOUTQ) emptying between frames. A frame costs its bytes at
+// that rate, or the time write() blocked if longer. When that outgrows the interval, playback shows
+// every d-th frame on the original clock, so it stays in step with the audio at a steady lower rate
+// instead of running slow. d rises as soon as the cost calls for it and falls one step at a time
+// after a stretch of headroom. While writes don't block the estimate is eased down now and then, so
+// a link that got faster is found again.
+constexpr double kPacingBudget = 0.85;          // Share of the time per shown frame a frame may cost
+constexpr double kPacingSmoothing = 0.25;       // Weight of the newest sample in the moving averages
+constexpr int kPacingWarmupFrames = 4;          // Samples before the first decision
+constexpr double kPacingRelaxSeconds = 2.0;     // Headroom needed for this long before d drops
+constexpr double kPacingRateMemorySeconds = 8.0; // Drain rate trusted this long without a fresh sample
+constexpr uint64_t kPacingBlockedWriteNs = 1000000; // A write taking longer than this waited on the link
+
+class FramePacer {
+public:
+    FramePacer(int fd, double framerate)
+        : fd_(fd), interval_ns_(1e9 / framerate),
+          max_decimation_(std::max(1, static_cast<int>(std::floor(framerate)))) { // Never below 1 fps
+        int queued = 0;
+        has_queue_ = ioctl(fd_, TIOCOUTQ, &queued) == 0;
+    }
+
+    int decimation() const { return decimation_; }
+    double effective_fps() const { return 1e9 / (interval_ns_ * decimation_); }
+
+    void before_write() {
+        const auto now = std::chrono::steady_clock::now();
+        const int queued = queued_bytes();
+        if (last_queued_ > 0 && queued > 0) {
+            // The queue never ran dry since the last write, so everything that left it went at the link's pace
+            const double drained = static_cast<double>(last_queued_ - queued);
+            const double elapsed = std::chrono::duration<double, std::nano>(now - last_write_end_).count();
+            if (drained > 0 && elapsed > 0) sample_rate(elapsed / drained, now);
+        }
+    }
+
+    // Returns true when the decimation changed
+    bool after_write(size_t bytes, uint64_t write_ns) {
+        const auto now = std::chrono::steady_clock::now();
+        const bool blocked = write_ns > kPacingBlockedWriteNs && bytes > 0;
+        if (blocked) {
+            // After a write that also blocked, the buffer was full throughout, so this frame's bytes took
+            // the whole gap to get out; otherwise only the wait itself is known, which may fall short
+            const double waited = last_write_blocked_ ? std::chrono::duration<double, std::nano>(now - last_write_end_).count()
+                                                      : static_cast<double>(write_ns);
+            sample_rate(waited / static_cast<double>(bytes), now);
+        } else if (ns_per_byte_ > 0 &&
+                   std::chrono::duration<double>(now - last_rate_sample_).count() > kPacingRateMemorySeconds) {
+            // Nothing has blocked for a while: try the link with one more frame per d, and let the
+            // next blocked write say whether it copes
+            ns_per_byte_ *= static_cast<double>(decimation_ - 1) / static_cast<double>(decimation_);
+            last_rate_sample_ = now;
+        }
+        last_write_end_ = now;
+        last_write_blocked_ = blocked;
+        last_queued_ = queued_bytes();
+        const double cost = std::max(static_cast<double>(write_ns), static_cast<double>(bytes) * ns_per_byte_);
+        stat_record(StatId::FrameDrain, static_cast<uint64_t>(cost));
+        average(cost_ns_, cost);
+        if (++samples_ < kPacingWarmupFrames) return false;
+
+        const int needed = std::clamp(static_cast<int>(std::ceil(cost_ns_ / (interval_ns_ * kPacingBudget))), 1, max_decimation_);
+        if (needed > decimation_) {
+            decimation_ = needed;
+            relax_since_ = last_write_end_;
+            return true;
+        }
+        if (needed == decimation_) {
+            relax_since_ = last_write_end_;
+            return false;
+        }
+        if (std::chrono::duration<double>(last_write_end_ - relax_since_).count() < kPacingRelaxSeconds) return false;
+        decimation_--;
+        relax_since_ = last_write_end_;
+        return true;
+    }
+
+private:
+    int queued_bytes() const {
+        int queued = 0;
+        if (!has_queue_ || ioctl(fd_, TIOCOUTQ, &queued) != 0) return 0;
+        return queued;
+    }
+
+    void sample_rate(double ns_per_byte, std::chrono::steady_clock::time_point at) {
+        average(ns_per_byte_, ns_per_byte);
+        last_rate_sample_ = at;
+    }
+
+    static void average(double& mean, double sample) {
+        mean = mean > 0 ? mean + kPacingSmoothing * (sample - mean) : sample;
+    }
+
+    int fd_;
+    double interval_ns_;
+    int max_decimation_;
+    bool has_queue_ = false;
+    int decimation_ = 1;
+    int samples_ = 0;
+    int last_queued_ = 0;
+    bool last_write_blocked_ = false;
+    double ns_per_byte_ = 0; // 0 while the link has not been seen draining a backlog
+    double cost_ns_ = 0;
+    std::chrono::steady_clock::time_point last_write_end_;
+    std::chrono::steady_clock::time_point last_rate_sample_;
+    std::chrono::steady_clock::time_point relax_since_;
+};
+
+// Ask the terminal whether it implements synchronized updates (DECRQM for mode 2026). A primary
+// device attributes request is sent right behind it: every terminal answers that, so terminals
+// that ignore DECRQM don't cost the full timeout.
+bool query_synchronized_update_support() {
+    if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) return false;
+    struct termios saved_termios;
+    if (tcgetattr(STDIN_FILENO, &saved_termios) != 0) return false;
+    struct termios raw_termios = saved_termios;
+    raw_termios.c_lflag &= static_cast<tcflag_t>(~(ICANON | ECHO));
+    raw_termios.c_cc[VMIN] = 0;
+    raw_termios.c_cc[VTIME] = 0;
+    tcsetattr(STDIN_FILENO, TCSANOW, &raw_termios);
+
+    const char query[] = "\033[?2026$p\033[c";
+    std::cout.flush();
+    write_all(STDOUT_FILENO, query, sizeof(query) - 1);
+
+    std::string reply;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(200);
+    bool got_device_attributes = false;
+    while (!got_device_attributes) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+        if (remaining <= 0) break;
+        struct pollfd pfd = {STDIN_FILENO, POLLIN, 0};
+        if (poll(&pfd, 1, static_cast<int>(remaining)) <= 0) break;
+        char buf[64];
+        ssize_t got = ::read(STDIN_FILENO, buf, sizeof(buf));
+        if (got <= 0) break;
+        reply.append(buf, static_cast<size_t>(got));
+        size_t da = reply.find("\033[?");
+        while (da != std::string::npos) { // DA1 reply looks like ESC [ ? ... c
+            size_t end = reply.find_first_not_of("0123456789;", da + 3);
+            if (end != std::string::npos && reply[end] == 'c') { got_device_attributes = true; break; }
+            da = reply.find("\033[?", da + 1);
+        }
+    }
+    tcsetattr(STDIN_FILENO, TCSANOW, &saved_termios);
+
+    // DECRPM reply: ESC [ ? 2026 ; Ps $ y with Ps 1 (set) or 2 (reset) meaning the mode is recognised
+    size_t mode_reply = reply.find("\033[?2026;");
+    bool supported = mode_reply != std::string::npos && mode_reply + 9 < reply.size() &&
+                     (reply[mode_reply + 9] == '1' || reply[mode_reply + 9] == '2');
+    print_verbose(std::string("Synchronized update (mode 2026) ") + (supported ? "supported" : "not supported") + " by terminal.");
+    return supported;
+}
+
+std::string g_daemon_socket_path; // Set in a --daemon once it listens; its socket file is removed on exit
+
 void cleanup_on_exit() {
+    if (!g_daemon_socket_path.empty()) unlink(g_daemon_socket_path.c_str());
     show_cursor();
+    g_shared_frame_texts.release();
     if (g_termios_saved) {
         tcsetattr(STDIN_FILENO, TCSANOW, &g_original_termios);
         print_verbose("Restored terminal settings on exit.");
@@ -885,6 +5201,11 @@ void cleanup_on_exit() {
          std::cout << "\033[" << term_size_cleanup.ws_row << ";" << 1 << "H" << std::flush;
     }
     std::cout << std::flush;
+    static bool stats_reported = false;
+    if (g_stats_enabled && !stats_reported) {
+        stats_reported = true;
+        report_stats(g_args.stats, g_args.stats_json_path);
+    }
 }
 
 void signal_handler(int signal_num) {
@@ -900,203 +5221,260 @@ void signal_handler(int signal_num) {
     }
     std::cout << "\033[K" << std::flush;
     std::cout << "Exiting due to signal " << signal_num << "...\n" << std::flush;
-    
+
+    if (g_asset_build_running.load() || (g_progressive_frames.active() && !g_progressive_frames.complete())) {
+        // The cache is still being built on other threads; don't tear globals down beneath them.
+        // Frames finished so far are in the render journal, and the next run resumes from there.
+        g_pipeline_error_occurred.store(true);
+        cleanup_on_exit();
+        std::_Exit(128 + signal_num);
+    }
+
     // Exit directly, atexit handlers will run.
     // _exit() would bypass atexit, which we don't want for ffplay cleanup.
     std::exit(128 + signal_num);
 }
 
-void generate_static_template() {
-    std::vector<std::string> info_lines;
-    std::string fetch_command = "fastfetch --logo none --pipe false"; // Assuming fastfetch is in PATH
-    std::string fetch_output_str = run_command_with_output_ex(fetch_command);
-
-    bool fastfetch_likely_missing = fetch_output_str.empty() &&
-                                    !std::filesystem::exists("/usr/bin/fastfetch") && // Common paths
-                                    !std::filesystem::exists("/bin/fastfetch") &&
-                                    !std::filesystem::exists("/usr/local/bin/fastfetch");
-
-    if (fastfetch_likely_missing) {
-        std::cerr << "Warning: Could not run fastfetch or it produced no output. Static info will be minimal.\n";
-        // Potentially add more ways to get system info as fallback here if desired
-    }
-
-    std::istringstream output_stream(fetch_output_str);
-    std::string line_buffer;
-    while(std::getline(output_stream, line_buffer)) {
-        info_lines.push_back(line_buffer);
-    }
-
-    // Fallback if fastfetch fails or provides no lines
-    if (info_lines.empty()){
-        int fallback_lines = (g_args.actual_chafa_height > 0) ? g_args.actual_chafa_height : g_args.height_arg;
-        for(int i=0; i < fallback_lines; ++i) info_lines.push_back(" "); // Fill with blank lines
+std::atomic<bool> g_terminal_resized(false); // Set on SIGWINCH; the player lays the screen out again before its next frame
+
+void terminal_resize_handler(int) { g_terminal_resized.store(true); }
+
+// Info Panel
+// The fastfetch text beside the animation. fastfetch's output is kept in .cache/fastfetch.txt: a copy
+// younger than --info-ttl is used as is, and an older one is shown at once while fastfetch runs on a
+// thread of its own beside asset preparation. With --info-refresh that thread keeps running it in the
+// background. Every run that changes the text bumps a generation the player checks once per frame.
+class InfoPanel {
+public:
+    void start(const std::filesystem::path& cache_path, double ttl_seconds, double refresh_seconds) {
+        state_ = std::make_shared<State>();
+        state_->cache_path = cache_path;
+        bool fresh = false;
+        std::error_code ec;
+        const auto modified = std::filesystem::last_write_time(cache_path, ec);
+        if (!ec) {
+            std::ifstream cache_file(cache_path, std::ios::binary);
+            std::string text((std::istreambuf_iterator<char>(cache_file)), std::istreambuf_iterator<char>());
+            if (!text.empty()) {
+                state_->lines = split_lines(text);
+                state_->text = std::move(text);
+                state_->generation.store(1);
+                const std::chrono::duration<double> age = std::filesystem::file_time_type::clock::now() - modified;
+                fresh = age.count() < ttl_seconds;
+            }
+        }
+        print_verbose(std::string("Info panel: ") + (state_->text.empty() ? "no cached fastfetch output" : fresh ? "cached fastfetch output is fresh"
+                                                                                                                : "cached fastfetch output is stale") +
+                      (refresh_seconds > 0 ? ", refreshing every " + std::to_string(refresh_seconds) + "s." : "."));
+        if (fresh && refresh_seconds <= 0) return;
+        // Detached like a progressive build; it only ever sleeps or waits on fastfetch
+        std::thread(fetch_loop, state_, !fresh, refresh_seconds).detach();
     }
 
-    struct winsize term_size_display;
-    int current_terminal_width = 80; // Default
-    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &term_size_display) == 0) {
-        current_terminal_width = term_size_display.ws_col;
+    // Copy the lines into `lines` if they changed since `generation`
+    bool poll(uint64_t& generation, std::vector<std::string>& lines) {
+        if (!state_ || state_->generation.load() == generation) return false;
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        lines = state_->lines;
+        generation = state_->generation.load();
+        return true;
     }
 
-    const int TEMPLATE_GAP = 2;
-    const int TEMPLATE_PAD_LEFT = 4; // Padding for animation area from left edge of screen
-    const int ANIM_AREA_WIDTH = g_args.width;
-
-    int effective_animation_height = (g_args.actual_chafa_height > 0) ? g_args.actual_chafa_height : g_args.height_arg;
-    if (effective_animation_height <=0) effective_animation_height = 20; // Absolute fallback
-
-    std::vector<std::string> final_template_lines;
-    for (int y = 0; y < std::max(effective_animation_height, static_cast<int>(info_lines.size())); ++y) {
-        std::string current_info_line = (static_cast<size_t>(y) < info_lines.size()) ? info_lines[y] : "";
-        
-        // Animation area placeholder (will be overwritten by animation frames)
-        std::string anim_placeholder = std::string(ANIM_AREA_WIDTH, ' ');
-
-        // Calculate space for info text
-        int info_area_start_col = TEMPLATE_PAD_LEFT + ANIM_AREA_WIDTH + TEMPLATE_GAP;
-        int available_width_for_info = current_terminal_width - info_area_start_col;
-        std::string info_segment_for_line;
+    // fastfetch ran and produced nothing, and there was no cached copy to show instead
+    bool unavailable() const { return state_ && state_->failed.load() && state_->generation.load() == 0; }
+
+    // Run fastfetch and store its output in cache_path; false if it failed or printed nothing
+    static bool refresh_cache(const std::filesystem::path& cache_path, std::string& output) {
+        const std::vector<std::string> fastfetch_cmd = {"fastfetch", "--logo", "none", "--pipe", "false"};
+        SubprocessOptions options;
+        options.output = &output;
+        options.quiet = true; // The player may own the screen already
+        options.timeout_ms = kToolTimeoutMs;
+        int exit_code;
+        {
+            ScopedStatTimer stat_timer(StatId::InfoFetch);
+            exit_code = run_subprocess(fastfetch_cmd, options);
+        }
+        if (exit_code != 0 || output.empty()) {
+            print_verbose("Info panel: '" + describe_command(fastfetch_cmd) + "' failed (exit code " + std::to_string(exit_code) + "); keeping the current text.");
+            return false;
+        }
 
-        if (available_width_for_info > 0) {
-            if (current_info_line.length() > static_cast<size_t>(available_width_for_info)) {
-                info_segment_for_line = current_info_line.substr(0, static_cast<size_t>(available_width_for_info));
-            } else {
-                info_segment_for_line = current_info_line;
-                // Pad with spaces to fill the available width for info, to ensure consistent clearing
-                info_segment_for_line += std::string(std::max(0, available_width_for_info - (int)info_segment_for_line.length()), ' ');
-            }
-        } else {
-            info_segment_for_line = ""; // No space for info
+        // Rewritten even when unchanged, as its modification time is what --info-ttl measures
+        std::error_code ec;
+        std::filesystem::create_directories(cache_path.parent_path(), ec);
+        std::filesystem::path temp_path = cache_path;
+        temp_path += "." + std::to_string(getpid()) + ".tmp"; // Other instances may refresh it at the same time
+        {
+            std::ofstream cache_file(temp_path, std::ios::binary | std::ios::trunc);
+            cache_file.write(output.data(), static_cast<std::streamsize>(output.size()));
+        }
+        std::filesystem::rename(temp_path, cache_path, ec);
+        if (ec) {
+            print_verbose("Info panel: could not update " + cache_path.string() + ": " + ec.message());
+            std::filesystem::remove(temp_path, ec);
         }
+        return true;
+    }
 
-        std::string full_line = std::string(TEMPLATE_PAD_LEFT, ' ') + // Left padding for animation
-                                anim_placeholder +                    // Animation area
-                                std::string(TEMPLATE_GAP, ' ') +      // Gap
-                                info_segment_for_line;                // Info text
+private:
+    struct State {
+        std::filesystem::path cache_path;
+        std::mutex mutex;
+        std::string text;                // Latest output; guarded by mutex
+        std::vector<std::string> lines;  // text split into lines; guarded by mutex
+        std::atomic<uint64_t> generation{0}; // Bumped after each change of lines, 0 while there are none
+        std::atomic<bool> failed{false};
+    };
 
-        // Ensure line does not exceed terminal width and pad if shorter
-        if (full_line.length() > static_cast<size_t>(current_terminal_width)) {
-            full_line = full_line.substr(0, static_cast<size_t>(current_terminal_width));
-        } else {
-            full_line += std::string(std::max(0, current_terminal_width - (int)full_line.length()), ' ');
-        }
-        final_template_lines.push_back(full_line + "\n"); // Add newline for file storage
+    static std::vector<std::string> split_lines(const std::string& text) {
+        std::vector<std::string> lines;
+        std::istringstream stream(text);
+        for (std::string line; std::getline(stream, line);) lines.push_back(std::move(line));
+        return lines;
     }
 
-    // Ensure g_video_specific_cache_root exists before writing template.txt
-    try {
-        if (!std::filesystem::exists(g_video_specific_cache_root)) {
-            std::filesystem::create_directories(g_video_specific_cache_root);
-            print_verbose("Created video-specific cache root for template: " + g_video_specific_cache_root.string());
+    static void fetch_loop(std::shared_ptr<State> state, bool fetch_now, double refresh_seconds) {
+        if (fetch_now) fetch(*state);
+        while (refresh_seconds > 0) {
+            std::this_thread::sleep_for(std::chrono::duration<double>(refresh_seconds));
+            fetch(*state);
         }
-    } catch (const std::filesystem::filesystem_error& e) {
-        std::cerr << "Error: Could not create directory for template.txt: " << g_video_specific_cache_root.string() 
-                  << ": " << e.what() << '\n';
     }
 
-    std::filesystem::path template_file_path = g_video_specific_cache_root / "template.txt";
-    std::ofstream template_output_file(template_file_path);
-    if (!template_output_file.is_open()) {
-        std::cerr << "Error: Could not write template.txt to " << template_file_path.string() << '\n';
-    } else {
-        for (const auto& template_line : final_template_lines) {
-            template_output_file << template_line;
+    static void fetch(State& state) {
+        std::string output;
+        if (!refresh_cache(state.cache_path, output)) {
+            state.failed.store(true);
+            return;
         }
-        template_output_file.close();
-        print_verbose("Static template written to: " + template_file_path.string());
+
+        std::lock_guard<std::mutex> lock(state.mutex);
+        if (output == state.text) return;
+        state.lines = split_lines(output);
+        state.text = std::move(output);
+        state.generation.fetch_add(1);
     }
-}
+
+    std::shared_ptr<State> state_;
+};
+
+InfoPanel g_info_panel;
+
+// Columns a pyramid level must leave the info panel before a wider level is chosen
+constexpr int kMinInfoColumns = 40;
 
 void run_animation_loop() {
     hide_cursor();
 
     const int ANIM_PAD_LEFT = 4;
-    const int ANIM_FRAME_WIDTH = g_args.width;
     const int SCREEN_TOP_PADDING = 2;
     const int ANIM_START_COL = ANIM_PAD_LEFT + 1;
+    const int INFO_GAP = 2;
+    int anim_frame_width = g_args.width;
 
     int anim_display_height = (g_args.actual_chafa_height > 0) ? g_args.actual_chafa_height : g_args.height_arg;
     if (anim_display_height <= 0) anim_display_height = 20; // Absolute fallback
 
+    // Without --pyramid the only level is the --horizontal one, and a resize just lays the screen out again
+    const std::vector<PyramidLevel> levels = collect_pyramid_levels();
+    size_t current_level = 0;
+    while (levels[current_level].width != g_args.width) current_level++;
+    // The widest level that fits the terminal's rows and leaves the info panel kMinInfoColumns, or the
+    // narrowest when none does
+    auto best_level = [&](int columns, int rows) {
+        size_t best = 0;
+        for (size_t i = 0; i < levels.size(); ++i) {
+            if (ANIM_PAD_LEFT + levels[i].width + INFO_GAP + kMinInfoColumns > columns) break;
+            if (rows <= 0 || SCREEN_TOP_PADDING + levels[i].rows <= rows) best = i;
+        }
+        return best;
+    };
+    signal(SIGWINCH, terminal_resize_handler);
+
+    if (g_args.sync_update == "on") g_sync_update_enabled = true;
+    else if (g_args.sync_update == "auto") g_sync_update_enabled = query_synchronized_update_support();
+
     clear_screen();
     for (int i = 0; i < SCREEN_TOP_PADDING; ++i) std::cout << '\n'; // Print top padding newlines
 
-    // Load and display static template
-    std::filesystem::path static_template_path = g_video_specific_cache_root / "template.txt";
-    if (std::filesystem::exists(static_template_path)) {
-        std::ifstream template_input_stream(static_template_path);
-        if (template_input_stream.is_open()) {
-            std::string template_line_content;
-            int template_display_row = SCREEN_TOP_PADDING + 1; // 1-based row
-            while (std::getline(template_input_stream, template_line_content)) {
-                 move_cursor(template_display_row++, 1); // Move to start of line
-                 // Remove trailing newline if getline included it
-                 if (!template_line_content.empty() && template_line_content.back() == '\n') {
-                    template_line_content.pop_back();
-                 }
-                 std::cout << template_line_content; // Print the full template line
-            }
-            template_input_stream.close();
-        } else { std::cerr << "Warning: template.txt found but could not be opened.\n"; }
-    } else { std::cerr << "Warning: template.txt not found. Static info will be missing.\n"; }
-    std::cout << std::flush; // Ensure template is drawn
-
-    // Load animation frames
-    std::vector<std::filesystem::path> ascii_frame_file_paths;
-    if (!std::filesystem::exists(g_processed_ascii_path) || !std::filesystem::is_directory(g_processed_ascii_path)) {
-        std::cerr << "Error: ASCII art path does not exist or not a directory: " << g_processed_ascii_path << '\n';
-        show_cursor();
-        std::exit(1);
-    }
-    // Iterate and collect .txt files
-    if (std::filesystem::exists(g_processed_ascii_path)) {
-        for (const auto& dir_entry : std::filesystem::directory_iterator(g_processed_ascii_path)) {
-            if (dir_entry.is_regular_file() && dir_entry.path().extension() == ".txt") {
-                ascii_frame_file_paths.push_back(dir_entry.path());
-            }
-        }
-    }
-    std::sort(ascii_frame_file_paths.begin(), ascii_frame_file_paths.end()); // Ensure correct order
-
-    std::vector<std::string> loaded_animation_frames;
-    if (!ascii_frame_file_paths.empty()) {
-        loaded_animation_frames.reserve(ascii_frame_file_paths.size());
-        print_verbose("Pre-loading " + std::to_string(ascii_frame_file_paths.size()) + " frames...");
-        for (const auto& frame_file : ascii_frame_file_paths) {
-            std::ifstream frame_input_stream(frame_file);
-            if (!frame_input_stream.is_open()) {
-                std::cerr << "\nError: Could not open frame file for pre-loading: " << frame_file << '\n';
-                continue; // Skip this frame
-            }
-            std::string frame_data_str((std::istreambuf_iterator<char>(frame_input_stream)), std::istreambuf_iterator<char>());
-            loaded_animation_frames.push_back(std::move(frame_data_str));
-        }
-        std::cout << "\r" << std::string(40, ' ') << "\r" << std::flush;
-    }
-
-    if (loaded_animation_frames.empty()) {
-        std::cout << "\nNo animation frames found/loaded. Check input video or cache.\nIf cache was used, try --force-render.\n";
-        show_cursor();
-        std::exit(1);
-    }
+    std::string frame_buffer; // Reused for every write to the screen
+    frame_buffer.reserve(64 * 1024);
+
+    // Info panel beside the animation area. Its lines are cut or padded to the width left of the terminal
+    // so a shorter line always covers a longer one drawn before it.
+    int terminal_width = 80; // Default
+    int terminal_rows = 0;   // Unknown
+    int info_start_col = 0;  // 0-based
+    size_t info_width = 0;
+    auto measure_terminal = [&]() {
+        struct winsize term_size_display;
+        if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &term_size_display) == 0 && term_size_display.ws_col > 0) {
+            terminal_width = term_size_display.ws_col;
+            terminal_rows = term_size_display.ws_row;
+        }
+    };
+    auto info_segment = [&info_width](const std::vector<std::string>& lines, size_t y) {
+        std::string segment = y < lines.size() ? lines[y].substr(0, info_width) : std::string();
+        segment.append(info_width - segment.size(), ' ');
+        return segment;
+    };
+
+    std::vector<std::string> info_lines;
+    uint64_t info_generation = 0;
+    g_info_panel.poll(info_generation, info_lines);
+    // Blank the animation area and draw the info panel beside it, for the current level and terminal width
+    auto draw_layout = [&]() {
+        info_start_col = ANIM_PAD_LEFT + anim_frame_width + INFO_GAP;
+        info_width = static_cast<size_t>(std::max(0, terminal_width - info_start_col));
+        for (size_t y = 0; y < std::max(static_cast<size_t>(anim_display_height), info_lines.size()); ++y) {
+            std::string full_line = std::string(static_cast<size_t>(info_start_col), ' ') + info_segment(info_lines, y);
+            full_line.resize(static_cast<size_t>(terminal_width), ' ');
+            append_cursor_move(frame_buffer, SCREEN_TOP_PADDING + 1 + static_cast<int>(y), 1);
+            frame_buffer += full_line;
+        }
+    };
+    measure_terminal();
+    begin_frame(frame_buffer);
+    draw_layout();
+    submit_frame(frame_buffer);
+    std::vector<std::string> refreshed_info_lines;
+
+    // Map animation frames. While a progressive build is still running, frames come from its in-memory
+    // store instead, and the pack is mapped as soon as the build has written it.
+    FramePack frame_pack;
+    DecodedFrameCache decoded_frames;
+    size_t frame_count = 0;
+    auto map_frame_pack = [&](const std::filesystem::path& pack_path) {
+        decoded_frames.stop();
+        g_shared_frame_texts.detach();
+        if (!frame_pack.open(pack_path)) {
+            std::cerr << "Error: Could not open frame pack: " << pack_path << '\n';
+            show_cursor();
+            std::exit(1);
+        }
+        frame_count = frame_pack.frame_count();
+        const bool texts_shared = g_shared_frame_texts.attach(frame_pack, g_args.memory_budget_bytes);
+        print_verbose("Mapped " + std::to_string(frame_count) + " frames from " + pack_path.string() +
+                      (texts_shared ? ", with their texts shared between instances"
+                                    : ", decoding ahead within " + std::to_string(g_args.memory_budget_bytes) + " bytes"));
+
+        if (frame_count == 0) {
+            std::cout << "\nNo animation frames found/loaded. Check input video or cache.\nIf cache was used, try --force-render.\n";
+            show_cursor();
+            std::exit(1);
+        }
+        decoded_frames.start(frame_pack, g_args.memory_budget_bytes, g_args.full_redraw, g_args.retain_frames, texts_shared);
+    };
+    bool playing_progressive = g_progressive_frames.active() && !g_progressive_frames.complete();
+    if (!playing_progressive) map_frame_pack(g_frame_pack_path);
 
     // Start ffplay for audio if configured
     if (g_args.sound_flag_given && !g_args.sound_saved_path.empty() && std::filesystem::exists(g_args.sound_saved_path)) {
-        g_ffplay_pid = fork();
-        if (g_ffplay_pid == 0) { // Child process
-            // Redirect stdin, stdout, stderr to /dev/null for ffplay
-            if (freopen("/dev/null", "r", stdin) == nullptr ||
-                freopen("/dev/null", "w", stdout) == nullptr ||
-                freopen("/dev/null", "w", stderr) == nullptr) {
-                // If redirection fails, ffplay might still print to terminal, but proceed.
-                // _exit to avoid running atexit handlers in child.
-                _exit(127); 
-            }
-            execlp("ffplay", "ffplay", "-nodisp", "-autoexit", "-loop", "0", "-loglevel", "quiet", g_args.sound_saved_path.c_str(), (char*)nullptr);
-            _exit(127); // execlp failed
-        } else if (g_ffplay_pid < 0) { // Fork failed
-            std::cerr << "\nFailed to fork for ffplay. Audio will not play.\n";
+        // stdin, stdout and stderr all on /dev/null
+        g_ffplay_pid = spawn_process({"ffplay", "-nodisp", "-autoexit", "-loop", "0", "-loglevel", "quiet", g_args.sound_saved_path}, -1, -1, true);
+        if (g_ffplay_pid < 0) { // Spawn failed
+            std::cerr << "\nFailed to start ffplay. Audio will not play.\n";
             g_ffplay_pid = -1; // Ensure it's marked as not running
         } else { // Parent process
             print_verbose("ffplay started (PID: " + std::to_string(g_ffplay_pid) + ") for audio: " + g_args.sound_saved_path);
@@ -1112,47 +5490,685 @@ void run_animation_loop() {
 
     auto animation_start_time = std::chrono::high_resolution_clock::now();
     long long current_frame_index = 0;
+    long long last_drawn_frame = -1; // Frame currently on screen, for delta playback
+    FramePacer pacer(STDOUT_FILENO, effective_framerate);
+    std::chrono::steady_clock::time_point last_frame_written;
+
+    // Returns false on a damaged delta, leaving the caller to redraw the full frame instead
+    auto append_delta = [&](size_t slot) {
+        std::string_view delta_ops = frame_pack.delta(slot);
+        size_t op_pos = 0;
+        while (op_pos + sizeof(DeltaOpHeader) <= delta_ops.size()) {
+            DeltaOpHeader op;
+            std::memcpy(&op, delta_ops.data() + op_pos, sizeof(op));
+            op_pos += sizeof(op);
+            if (op.length > delta_ops.size() - op_pos) return false;
+            if (op.row < anim_display_height && op.col < anim_frame_width) {
+                append_cursor_move(frame_buffer, SCREEN_TOP_PADDING + 1 + op.row, ANIM_START_COL + op.col);
+                frame_buffer.append(delta_ops.data() + op_pos, op.length);
+            }
+            op_pos += op.length;
+        }
+        return true;
+    };
 
     while (true) {
-        const auto& ascii_art_for_frame = loaded_animation_frames[current_frame_index % loaded_animation_frames.size()];
-        std::stringstream frame_data_stream(ascii_art_for_frame);
-        int screen_row_for_line = SCREEN_TOP_PADDING + 1;
-        std::string ascii_line_content;
-        int lines_drawn_count = 0;
-
-        while (std::getline(frame_data_stream, ascii_line_content)) {
-            if (lines_drawn_count >= anim_display_height) break;
-            
-            move_cursor(screen_row_for_line, ANIM_START_COL);
-            std::cout << ascii_line_content;
-            
-            screen_row_for_line++;
-            lines_drawn_count++;
-        }
-
-        while (lines_drawn_count < anim_display_height) {
-            move_cursor(screen_row_for_line, ANIM_START_COL);
-            std::cout << std::string(ANIM_FRAME_WIDTH, ' ');
-            screen_row_for_line++;
-            lines_drawn_count++;
-        }
-        hide_cursor();
-
-        current_frame_index++;
-        std::chrono::duration<double> target_elapsed = std::chrono::duration<double>(static_cast<double>(current_frame_index) / effective_framerate);
+        if (playing_progressive && g_progressive_frames.complete()) {
+            map_frame_pack(g_frame_pack_path);
+            playing_progressive = false;
+            last_drawn_frame = -1; // The pack may have dropped frames, so start it with a full redraw
+        }
+
+        if (g_terminal_resized.exchange(false)) {
+            // Switch to the level that fits the new size, keeping the play position, and lay the screen out again
+            ScopedStatTimer resize_timer(StatId::TerminalResize);
+            measure_terminal();
+            const size_t level = best_level(terminal_width, terminal_rows);
+            if (level != current_level && !playing_progressive) {
+                current_level = level;
+                anim_frame_width = levels[level].width;
+                anim_display_height = levels[level].rows;
+                map_frame_pack(levels[level].pack_path);
+                print_verbose("Terminal is " + std::to_string(terminal_width) + "x" + std::to_string(terminal_rows) +
+                              ": switched to the " + std::to_string(anim_frame_width) + "-column pyramid level.");
+            }
+            begin_frame(frame_buffer);
+            frame_buffer += "\033[H\033[2J";
+            draw_layout();
+            submit_frame(frame_buffer);
+            last_drawn_frame = -1; // The screen was cleared, so the next frame is drawn in full
+        }
+
+        std::string_view progressive_frame;
+        if (playing_progressive) {
+            if (static_cast<size_t>(current_frame_index) >= g_progressive_frames.ready_prefix()) {
+                stat_record(StatId::FramesHeld, 1);
+                if (g_ffplay_pid <= 0) {
+                    // Nothing to stay in sync with: wait for the renderer, then resume the clock from here
+                    g_progressive_frames.wait_for_frames(static_cast<size_t>(current_frame_index) + 1, std::chrono::milliseconds(100));
+                    animation_start_time = std::chrono::high_resolution_clock::now() -
+                        std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(
+                            std::chrono::duration<double>(static_cast<double>(current_frame_index) / effective_framerate));
+                    continue;
+                }
+                // Audio keeps playing: hold the frame on screen and let the clock run on
+            } else {
+                progressive_frame = g_progressive_frames.frame(static_cast<size_t>(current_frame_index));
+            }
+        }
+
+        const size_t frame_slot = playing_progressive ? static_cast<size_t>(current_frame_index)
+            : static_cast<size_t>(current_frame_index % static_cast<long long>(frame_count));
+        // Deltas leading from the frame on screen to this one; with frames skipped, the chain is only
+        // used while it is smaller than the full frame
+        size_t delta_chain = 0;
+        if (!g_args.full_redraw && !playing_progressive && last_drawn_frame >= 0) {
+            const size_t steps = (frame_slot + frame_count - static_cast<size_t>(last_drawn_frame)) % frame_count;
+            size_t chain_bytes = 0;
+            for (size_t k = 1; k <= steps; ++k) {
+                const size_t slot = (static_cast<size_t>(last_drawn_frame) + k) % frame_count;
+                if (!frame_pack.has_delta(slot)) break;
+                chain_bytes += frame_pack.delta(slot).size();
+                if (k > 1 && chain_bytes >= frame_pack.frame_size(frame_slot)) break;
+                if (k == steps) delta_chain = steps;
+            }
+        }
+        if (!playing_progressive) decoded_frames.advance(frame_slot);
+
+        const auto compose_start = std::chrono::steady_clock::now();
+        begin_frame(frame_buffer);
+        if (delta_chain > 0) {
+            // Only rewrite the cell spans that differ from the frame on screen
+            const size_t chain_start = frame_buffer.size();
+            for (size_t k = delta_chain; k > 0; --k) {
+                if (!append_delta((frame_slot + frame_count - k + 1) % frame_count)) {
+                    frame_buffer.resize(chain_start);
+                    delta_chain = 0;
+                    break;
+                }
+            }
+        }
+        if (playing_progressive && progressive_frame.empty()) {
+            // Held or skipped frame: leave the screen as it is
+        } else if (delta_chain > 0) {
+            // Delta chain already appended above
+        } else {
+            DecodedFrameCache::Text decoded_text; // Keeps the text alive while it is drawn
+            std::string_view ascii_art_for_frame = progressive_frame;
+            if (!playing_progressive && g_shared_frame_texts.is_open()) {
+                ascii_art_for_frame = g_shared_frame_texts.frame(frame_slot);
+            } else if (!playing_progressive) {
+                decoded_text = decoded_frames.frame(frame_slot);
+                ascii_art_for_frame = *decoded_text;
+            }
+            int screen_row_for_line = SCREEN_TOP_PADDING + 1;
+            int lines_drawn_count = 0;
+
+            size_t line_start = 0;
+            while (line_start < ascii_art_for_frame.size()) {
+                if (lines_drawn_count >= anim_display_height) break;
+                size_t line_end = ascii_art_for_frame.find('\n', line_start);
+                if (line_end == std::string_view::npos) line_end = ascii_art_for_frame.size();
+
+                append_cursor_move(frame_buffer, screen_row_for_line, ANIM_START_COL);
+                frame_buffer.append(ascii_art_for_frame.data() + line_start, line_end - line_start);
+
+                line_start = line_end + 1;
+                screen_row_for_line++;
+                lines_drawn_count++;
+            }
+
+            while (lines_drawn_count < anim_display_height) {
+                append_cursor_move(frame_buffer, screen_row_for_line, ANIM_START_COL);
+                frame_buffer.append(static_cast<size_t>(anim_frame_width), ' ');
+                screen_row_for_line++;
+                lines_drawn_count++;
+            }
+        }
+        last_drawn_frame = static_cast<long long>(frame_slot);
+        if (info_width > 0 && g_info_panel.poll(info_generation, refreshed_info_lines)) {
+            // fastfetch ran again: rewrite only the info lines that changed, in the same frame write
+            for (size_t y = 0; y < std::max(info_lines.size(), refreshed_info_lines.size()); ++y) {
+                std::string segment = info_segment(refreshed_info_lines, y);
+                if (segment == info_segment(info_lines, y)) continue;
+                append_cursor_move(frame_buffer, SCREEN_TOP_PADDING + 1 + static_cast<int>(y), info_start_col + 1);
+                frame_buffer += segment;
+            }
+            info_lines.swap(refreshed_info_lines);
+        }
+        frame_buffer += "\033[?25l"; // Keep the cursor hidden
+        stat_record(StatId::FrameCompose, stat_elapsed_ns(compose_start));
+        stat_record(StatId::FrameBytes, frame_buffer.size());
+        pacer.before_write();
+        const auto write_start = std::chrono::steady_clock::now();
+        submit_frame(frame_buffer);
+        const uint64_t write_ns = stat_elapsed_ns(write_start);
+        stat_record(StatId::FrameWrite, write_ns);
+        if (last_frame_written != std::chrono::steady_clock::time_point()) {
+            stat_record(StatId::FrameInterval, stat_elapsed_ns(last_frame_written));
+        }
+        last_frame_written = std::chrono::steady_clock::now();
+        if (pacer.after_write(frame_buffer.size(), write_ns)) {
+            std::ostringstream rate;
+            rate << std::fixed << std::setprecision(2) << pacer.effective_fps();
+            print_verbose("Terminal drains frames too slowly for every frame: showing every " +
+                          std::to_string(pacer.decimation()) + " frame(s), " + rate.str() + " fps.");
+        }
+        if (current_frame_index == 0) {
+            const uint64_t startup_ns = stat_elapsed_ns(g_process_start);
+            stat_record(StatId::StartupToFirstFrame, startup_ns);
+            print_verbose("First frame drawn " + std::to_string(startup_ns / 1000) + " us after start-up.");
+        }
+
+        // Frames shown are kept on multiples of the decimation, so the skipping pattern stays even
+        const long long step = pacer.decimation();
+        long long next_frame_index = (current_frame_index / step + 1) * step;
+        std::chrono::duration<double> target_elapsed = std::chrono::duration<double>(static_cast<double>(next_frame_index) / effective_framerate);
         std::chrono::duration<double> actual_elapsed = std::chrono::high_resolution_clock::now() - animation_start_time;
         std::chrono::duration<double> wait_duration = target_elapsed - actual_elapsed;
+        if (wait_duration.count() < -(1.5 * static_cast<double>(step) / effective_framerate)) {
+            // Still behind: jump to the frame that is due now rather than let the animation run slow
+            const long long due_index = static_cast<long long>(std::ceil(actual_elapsed.count() * effective_framerate / static_cast<double>(step))) * step;
+            next_frame_index = std::max(next_frame_index, due_index);
+            target_elapsed = std::chrono::duration<double>(static_cast<double>(next_frame_index) / effective_framerate);
+            wait_duration = target_elapsed - actual_elapsed;
+        }
+        if (next_frame_index > current_frame_index + 1) {
+            stat_record(StatId::FramesSkipped, static_cast<uint64_t>(next_frame_index - current_frame_index - 1));
+        }
+        current_frame_index = next_frame_index;
 
         if (wait_duration.count() > 0) {
              std::this_thread::sleep_for(wait_duration);
-        } else if (wait_duration.count() < -(1.5 / effective_framerate)) {
-            std::chrono::duration<double> new_offset_from_now = std::chrono::duration<double>(static_cast<double>(current_frame_index) / effective_framerate);
-            animation_start_time = std::chrono::high_resolution_clock::now() - std::chrono::duration_cast<std::chrono::high_resolution_clock::duration>(new_offset_from_now);
+             if (g_stats_enabled) {
+                 std::chrono::duration<double> woke_at = std::chrono::high_resolution_clock::now() - animation_start_time;
+                 stat_record(StatId::ScheduleJitter, static_cast<uint64_t>(std::abs(woke_at.count() - target_elapsed.count()) * 1e9));
+             }
+        }
+    }
+}
+
+// Daemon
+// `--daemon` stays resident and prepares animations for `--connect` clients of the same user. A
+// client sends its working directory, colour environment and arguments over a Unix socket, and gets
+// back what a warm start reads from its manifest; it then plays the animation itself. A miss is
+// prepared by a child forked for it, so the daemon stays single-threaded and safe to fork. At most
+// kDaemonMaxJobs children run at once, each with its share of the hardware threads, and further
+// misses queue; clients asking for an animation already running or queued join that job. The
+// daemon keeps each prepared animation's decoded texts in /dev/shm alive, so clients map them instead
+// of decoding, and it refreshes the fastfetch output of the directories it serves before it goes stale.
+const char kDaemonMagic[] = "ANIFETCH-DAEMON-1";
+constexpr uint32_t kDaemonMaxMessage = 1 << 20;
+constexpr int kDaemonWaitNoticeMs = 100;       // A client without a reply by then says it is waiting
+constexpr double kDaemonIdleSeconds = 3600.0;  // Animations and directories nobody asked for this long are dropped
+constexpr double kDaemonMinInfoRefresh = 5.0;  // Seconds between fastfetch runs for one directory, at least
+constexpr unsigned int kDaemonMaxJobs = 2;     // Children preparing animations at once
+
+// Messages are a 32-bit length followed by that many bytes of NUL-terminated fields
+bool send_daemon_message(int fd, const std::vector<std::string>& fields) {
+    std::string message(sizeof(uint32_t), '\0');
+    for (const std::string& field : fields) {
+        message += field;
+        message += '\0';
+    }
+    const uint32_t length = static_cast<uint32_t>(message.size() - sizeof(uint32_t));
+    std::memcpy(message.data(), &length, sizeof(length));
+    const char* data = message.data();
+    size_t left = message.size();
+    while (left > 0) {
+        ssize_t sent = send(fd, data, left, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        left -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool receive_daemon_message(int fd, std::vector<std::string>& fields) {
+    auto receive_all = [fd](char* data, size_t len) {
+        while (len > 0) {
+            ssize_t got = recv(fd, data, len, 0);
+            if (got < 0 && errno == EINTR) continue;
+            if (got <= 0) return false;
+            data += got;
+            len -= static_cast<size_t>(got);
         }
+        return true;
+    };
+    uint32_t length;
+    if (!receive_all(reinterpret_cast<char*>(&length), sizeof(length)) || length > kDaemonMaxMessage) return false;
+    std::string payload(length, '\0');
+    if (!receive_all(payload.data(), length)) return false;
+    fields.clear();
+    for (size_t start = 0; start < payload.size();) {
+        const size_t end = payload.find('\0', start);
+        if (end == std::string::npos) return false;
+        fields.push_back(payload.substr(start, end - start));
+        start = end + 1;
+    }
+    return true;
+}
+
+sockaddr_un daemon_socket_address(const std::string& path) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1); // Length checked in parse_arguments
+    return address;
+}
+
+// Replies are {"ok", video path, rows, frame count, sound path, pack path, video identity} or {"error", reason}
+constexpr size_t kDaemonReplyFields = 7;
+
+// --connect: have the daemon prepare the animation and take its results as a warm start would. False
+// when no daemon answers or it could not prepare the animation; the caller then prepares it itself.
+bool request_from_daemon(int argc, char* argv[]) {
+    ScopedStatTimer stat_timer(StatId::DaemonRequest);
+    const sockaddr_un address = daemon_socket_address(g_args.socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+        print_verbose("Daemon: nothing is listening on " + g_args.socket_path + "; preparing the animation here.");
+        if (fd >= 0) ::close(fd);
+        return false;
+    }
+
+    std::error_code ec;
+    const char* colorterm = std::getenv("COLORTERM");
+    const char* term = std::getenv("TERM");
+    std::vector<std::string> request = {kDaemonMagic, std::filesystem::current_path(ec).string(), colorterm ? colorterm : "", term ? term : ""};
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--connect") continue;
+        if (arg == "--socket") { ++i; continue; }
+        request.push_back(arg);
+    }
+    std::vector<std::string> reply;
+    bool answered = send_daemon_message(fd, request);
+    if (answered) {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, kDaemonWaitNoticeMs) == 0) std::cout << "Waiting for the daemon to prepare this animation...\n" << std::flush;
+        answered = receive_daemon_message(fd, reply);
+    }
+    ::close(fd);
+
+    int rows = 0, frames = 0;
+    auto parse_int = [](const std::string& text, int& value) {
+        return std::from_chars(text.data(), text.data() + text.size(), value).ec == std::errc() && value > 0;
+    };
+    if (!answered || reply.size() != kDaemonReplyFields || reply[0] != "ok" || !parse_int(reply[2], rows) || !parse_int(reply[3], frames)) {
+        const std::string reason = (reply.size() == 2 && reply[0] == "error") ? reply[1] : "no usable reply";
+        print_verbose("Daemon: " + reason + "; preparing the animation here.");
+        return false;
+    }
+    g_args.filename = reply[1];
+    g_args.actual_chafa_height = rows;
+    g_args.num_frames = frames;
+    g_args.sound_saved_path = reply[4];
+    use_frame_pack_path(reply[5]);
+    g_args.video_identity = reply[6];
+    g_args.force_render = false; // The daemon has just rendered it
+    print_verbose("Daemon: " + std::to_string(frames) + " frames ready in " + reply[5]);
+    return true;
+}
+
+// Size, modification time, inode and device; zeros when the file is gone
+std::array<uint64_t, 4> file_fingerprint(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return {};
+    return {static_cast<uint64_t>(st.st_size), stat_time_ns(st.st_mtim), static_cast<uint64_t>(st.st_ino), static_cast<uint64_t>(st.st_dev)};
+}
+
+// In a child of the daemon: prepare what the request asks for as a cold start would and send the reply,
+// plus whether the texts went into /dev/shm, on fd
+[[noreturn]] void run_daemon_job(const std::vector<std::string>& request, int fd) {
+    if (chdir(request[1].c_str()) != 0) {
+        send_daemon_message(fd, {"error", "the daemon could not enter " + request[1]});
+        std::_Exit(1);
+    }
+    auto set_environment = [](const char* name, const std::string& value) {
+        if (value.empty()) unsetenv(name);
+        else setenv(name, value.c_str(), 1);
+    };
+    set_environment("COLORTERM", request[2]);
+    set_environment("TERM", request[3]);
+
+    const bool verbose = g_args.verbose; // The daemon's own, as this output goes to its log
+    std::vector<char*> argv = {const_cast<char*>("anifetch")};
+    for (size_t i = 4; i < request.size(); ++i) argv.push_back(const_cast<char*>(request[i].c_str()));
+    g_args = AnifetchArgs();
+    parse_arguments(static_cast<int>(argv.size()), argv.data());
+    g_args.verbose = verbose;
+    g_args.stats = false; // Statistics are the client's to report
+    g_args.stats_json_path.clear();
+    g_stats_enabled = false;
+    g_args.progressive_frames = 0; // Clients only ever get a finished pack
+    if (g_args.threads == 0) g_args.threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency() / kDaemonMaxJobs));
+
+    std::error_code ec;
+    if (!std::filesystem::is_regular_file(g_args.filename, ec)) {
+        send_daemon_message(fd, {"error", "input file '" + g_args.filename + "' not found by the daemon"});
+        std::_Exit(1);
     }
+    g_args.actual_chafa_height = g_args.height_arg;
+    if (g_args.force_render || !load_manifest()) prepare_animation_assets();
+    render_pyramid_levels();
+
+    // Left in place by _Exit for the daemon to hold
+    FramePack pack;
+    SharedFrameTexts texts;
+    const bool texts_shared = pack.open(g_frame_pack_path) && texts.attach(pack, g_args.memory_budget_bytes);
+    send_daemon_message(fd, {"ok", std::filesystem::absolute(g_args.filename, ec).string(), std::to_string(g_args.actual_chafa_height),
+                             std::to_string(g_args.num_frames), g_args.sound_saved_path, g_frame_pack_path.string(), g_args.video_identity,
+                             texts_shared ? "1" : "0"});
+    std::cout << std::flush;
+    std::_Exit(0);
 }
 
+volatile sig_atomic_t g_daemon_stop = 0;
+
+void daemon_stop_handler(int) { g_daemon_stop = 1; }
+
+class AnimationDaemon {
+public:
+    int run() {
+        signal(SIGPIPE, SIG_IGN); // A client that hangs up must not take the daemon down
+        signal(SIGINT, daemon_stop_handler);
+        signal(SIGTERM, daemon_stop_handler);
+        const std::string& path = g_args.socket_path;
+        const sockaddr_un address = daemon_socket_address(path);
+        struct stat st;
+        if (lstat(path.c_str(), &st) == 0) {
+            if (!S_ISSOCK(st.st_mode) || st.st_uid != getuid()) {
+                std::cerr << "Error: " << path << " exists and is not a socket of this user's; not replacing it.\n";
+                exit(1);
+            }
+            int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+            if (probe >= 0 && connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0) {
+                std::cerr << "Error: another anifetch daemon is already listening on " << path << ".\n";
+                exit(1);
+            }
+            if (probe >= 0) ::close(probe);
+            unlink(path.c_str()); // Nobody answers on it, so it was left by a daemon that crashed
+        }
+        listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        const mode_t saved_umask = umask(077); // The socket is 0600 from the moment it exists
+        const bool bound = listen_fd_ >= 0 && bind(listen_fd_, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+        umask(saved_umask);
+        if (!bound || listen(listen_fd_, 64) != 0) {
+            std::cerr << "Error: Could not listen on " << path << ": " << std::strerror(errno) << '\n';
+            exit(1);
+        }
+        g_daemon_socket_path = path;
+        std::cout << "anifetch daemon listening on " << path << '\n' << std::flush;
+
+        while (!g_daemon_stop) {
+            std::vector<struct pollfd> fds = {{listen_fd_, POLLIN, 0}};
+            for (const Job& job : jobs_) fds.push_back({job.fd, POLLIN, 0});
+            if (poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR) {
+                std::cerr << "Error: Daemon poll failed: " << std::strerror(errno) << '\n';
+                exit(1);
+            }
+            for (size_t j = jobs_.size(); j-- > 0;) {
+                if (fds[j + 1].revents == 0) continue;
+                finish_job(jobs_[j]);
+                jobs_.erase(jobs_.begin() + static_cast<std::ptrdiff_t>(j));
+            }
+            if (fds[0].revents & POLLIN) serve_client();
+            start_queued_jobs();
+            reap_children();
+            refresh_info_panels();
+            std::cout << std::flush; // The log may be a file or a pipe
+        }
+
+        // Jobs still running finish their packs on their own; their clients prepare the animation themselves
+        print_verbose("Daemon: stopping; releasing " + std::to_string(resident_.size()) + " resident animations.");
+        for (Job& job : jobs_) ::close(job.fd);
+        for (const std::deque<Job>* jobs : {&jobs_, &queued_jobs_}) {
+            for (const Job& job : *jobs) {
+                for (int client : job.clients) ::close(client);
+            }
+        }
+        while (!resident_.empty()) drop(resident_.begin());
+        ::close(listen_fd_);
+        return 0;
+    }
+
+private:
+    struct Resident {
+        std::vector<std::string> reply;
+        std::array<uint64_t, 4> video_fingerprint{};
+        std::array<uint64_t, 4> pack_fingerprint{};
+        std::unique_ptr<SharedFrameTexts> texts; // Held so the texts outlive every client between runs
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    struct Job {
+        std::string key;
+        std::vector<std::string> request;
+        std::vector<int> clients;
+        pid_t pid = -1;       // Set once it runs
+        int fd = -1;          // Reply from the child
+    };
+
+    struct Directory {
+        double info_ttl = 300.0;
+        pid_t refresh_pid = -1;
+        std::chrono::steady_clock::time_point last_refresh{};
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    static double seconds_since(std::chrono::steady_clock::time_point then) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - then).count();
+    }
+
+    // Fork with the daemon's sockets closed in the child
+    pid_t fork_child() {
+        std::cout << std::flush; // Or the child writes out the daemon's buffered output again
+        pid_t pid = fork();
+        if (pid == 0) {
+            signal(SIGINT, signal_handler);
+            signal(SIGTERM, signal_handler);
+            ::close(listen_fd_);
+            for (const Job& job : jobs_) ::close(job.fd);
+            for (const std::deque<Job>* jobs : {&jobs_, &queued_jobs_}) {
+                for (const Job& job : *jobs) {
+                    for (int client : job.clients) ::close(client);
+                }
+            }
+            g_daemon_socket_path.clear();
+        } else if (pid < 0) {
+            print_verbose(std::string("Daemon: fork failed: ") + std::strerror(errno));
+        }
+        return pid;
+    }
+
+    void reply_and_close(int client, const std::vector<std::string>& reply) {
+        send_daemon_message(client, reply);
+        ::close(client);
+    }
+
+    void drop(std::map<std::string, Resident>::iterator it) {
+        if (it->second.texts) it->second.texts->detach();
+        resident_.erase(it);
+    }
+
+    void serve_client() {
+        int client = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) return;
+        struct ucred peer;
+        socklen_t peer_length = sizeof(peer);
+        if (getsockopt(client, SOL_SOCKET, SO_PEERCRED, &peer, &peer_length) != 0 || peer.uid != getuid()) {
+            print_verbose("Daemon: refused a connection from another user.");
+            ::close(client);
+            return;
+        }
+        const struct timeval timeout = {1, 0}; // Clients send at once; don't let a stuck one hold the daemon
+        setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        std::vector<std::string> request;
+        if (!receive_daemon_message(client, request) || request.size() < 4 || request[0] != kDaemonMagic) {
+            print_verbose("Daemon: dropped a connection without a valid request.");
+            ::close(client);
+            return;
+        }
+
+        std::string key;
+        bool force_render = false, render_only = false;
+        double info_ttl = 300.0;
+        for (size_t i = 1; i < request.size(); ++i) {
+            if (request[i] == "--force-render") {
+                force_render = true; // A forced render replaces the resident result, so it shares its key
+                continue;
+            }
+            key += request[i];
+            key += '\0';
+            if (request[i] == "--render-only") render_only = true;
+            else if (request[i] == "--info-ttl" && i + 1 < request.size()) info_ttl = std::strtod(request[i + 1].c_str(), nullptr);
+        }
+        if (!render_only) {
+            Directory& directory = directories_[request[1]];
+            directory.info_ttl = info_ttl;
+            directory.last_used = std::chrono::steady_clock::now();
+        }
+
+        if (!force_render) {
+            auto it = resident_.find(key);
+            if (it != resident_.end()) {
+                Resident& entry = it->second;
+                if (file_fingerprint(entry.reply[1]) == entry.video_fingerprint && file_fingerprint(entry.reply[5]) == entry.pack_fingerprint) {
+                    entry.last_used = std::chrono::steady_clock::now();
+                    print_verbose("Daemon: " + entry.reply[1] + " is resident; replying at once.");
+                    reply_and_close(client, entry.reply);
+                    return;
+                }
+                print_verbose("Daemon: " + entry.reply[1] + " or its frame pack changed on disk; preparing it again.");
+                drop(it);
+            }
+            for (std::deque<Job>* jobs : {&jobs_, &queued_jobs_}) {
+                for (Job& job : *jobs) {
+                    if (job.key == key) {
+                        job.clients.push_back(client);
+                        return;
+                    }
+                }
+            }
+        }
+        queued_jobs_.push_back({key, std::move(request), {client}});
+    }
+
+    void start_queued_jobs() {
+        while (jobs_.size() < kDaemonMaxJobs && !queued_jobs_.empty()) {
+            Job job = std::move(queued_jobs_.front());
+            queued_jobs_.pop_front();
+            int pair[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pair) != 0) {
+                for (int client : job.clients) reply_and_close(client, {"error", "the daemon is out of file descriptors"});
+                continue;
+            }
+            pid_t pid = fork_child();
+            if (pid == 0) {
+                ::close(pair[0]);
+                for (int client : job.clients) ::close(client);
+                run_daemon_job(job.request, pair[1]);
+            }
+            ::close(pair[1]);
+            if (pid < 0) {
+                ::close(pair[0]);
+                for (int client : job.clients) reply_and_close(client, {"error", "the daemon could not start a job"});
+                continue;
+            }
+            print_verbose("Daemon: preparing an animation for " + job.request[1] + " in PID " + std::to_string(pid) +
+                          (queued_jobs_.empty() ? "" : "; " + std::to_string(queued_jobs_.size()) + " more queued"));
+            job.pid = pid;
+            job.fd = pair[0];
+            jobs_.push_back(std::move(job));
+        }
+    }
+
+    void finish_job(Job& job) {
+        std::vector<std::string> reply;
+        const bool received = receive_daemon_message(job.fd, reply);
+        ::close(job.fd);
+        if (received && reply.size() == kDaemonReplyFields + 1 && reply[0] == "ok") {
+            const bool texts_shared = reply.back() == "1";
+            reply.pop_back();
+            auto previous = resident_.find(job.key);
+            if (previous != resident_.end()) drop(previous);
+            Resident& entry = resident_[job.key];
+            entry.reply = reply;
+            entry.video_fingerprint = file_fingerprint(reply[1]);
+            entry.pack_fingerprint = file_fingerprint(reply[5]);
+            entry.last_used = std::chrono::steady_clock::now();
+            FramePack pack;
+            if (texts_shared && pack.open(reply[5])) {
+                entry.texts = std::make_unique<SharedFrameTexts>();
+                if (!entry.texts->attach(pack, std::numeric_limits<size_t>::max())) entry.texts.reset();
+            }
+            print_verbose("Daemon: " + reply[1] + " is now resident" + (entry.texts ? ", with its texts shared." : "."));
+        } else if (!received || reply.size() != 2 || reply[0] != "error") {
+            reply = {"error", "the daemon could not prepare this animation (see its output)"};
+        }
+        for (int client : job.clients) reply_and_close(client, reply);
+    }
+
+    void reap_children() {
+        int status;
+        for (pid_t pid; (pid = waitpid(-1, &status, WNOHANG)) > 0;) {
+            for (auto& entry : directories_) {
+                if (entry.second.refresh_pid == pid) entry.second.refresh_pid = -1;
+            }
+        }
+    }
+
+    // Run fastfetch for the directories served lately once their output is half as old as --info-ttl
+    // allows, so clients find it fresh and never run fastfetch themselves
+    void refresh_info_panels() {
+        for (auto it = resident_.begin(); it != resident_.end();) {
+            auto next = std::next(it);
+            if (seconds_since(it->second.last_used) > kDaemonIdleSeconds) drop(it);
+            it = next;
+        }
+        for (auto it = directories_.begin(); it != directories_.end();) {
+            Directory& directory = it->second;
+            if (directory.refresh_pid < 0 && seconds_since(directory.last_used) > kDaemonIdleSeconds) {
+                it = directories_.erase(it);
+                continue;
+            }
+            if (directory.refresh_pid < 0 && seconds_since(directory.last_refresh) >= kDaemonMinInfoRefresh) {
+                const std::filesystem::path cache_path = std::filesystem::path(it->first) / ".cache" / "fastfetch.txt";
+                std::error_code ec;
+                const auto modified = std::filesystem::last_write_time(cache_path, ec);
+                const double age = ec ? std::numeric_limits<double>::infinity()
+                                      : std::chrono::duration<double>(std::filesystem::file_time_type::clock::now() - modified).count();
+                if (age >= directory.info_ttl / 2) {
+                    directory.last_refresh = std::chrono::steady_clock::now();
+                    pid_t pid = fork_child();
+                    if (pid == 0) {
+                        std::string output;
+                        InfoPanel::refresh_cache(cache_path, output);
+                        std::_Exit(0);
+                    }
+                    directory.refresh_pid = pid;
+                }
+            }
+            ++it;
+        }
+    }
+
+    int listen_fd_ = -1;
+    std::map<std::string, Resident> resident_; // By working directory, colour environment and arguments
+    std::deque<Job> jobs_;         // Running
+    std::deque<Job> queued_jobs_;  // Waiting for a running job to finish
+    std::map<std::string, Directory> directories_;
+};
+
 int main(int argc, char* argv[]) {
+    // Frames go out through write() in one piece; everything else is small, so give iostreams
+    // their own large buffer instead of keeping them in lockstep with stdio
+    std::ios::sync_with_stdio(false);
+
     if (isatty(STDIN_FILENO)) {
         if (tcgetattr(STDIN_FILENO, &g_original_termios) == 0) {
             g_termios_saved = true;
@@ -1170,6 +6186,7 @@ int main(int argc, char* argv[]) {
 
     parse_arguments(argc, argv);
     if (g_termios_saved) print_verbose("Original terminal settings saved.");
+    if (g_args.daemon) return AnimationDaemon().run();
 
     if (!std::filesystem::exists(g_args.filename)) {
         std::cerr << "Error: Input file '" << g_args.filename << "' not found.\n";
@@ -1182,7 +6199,15 @@ int main(int argc, char* argv[]) {
 
     g_args.actual_chafa_height = g_args.height_arg; 
 
-    prepare_animation_assets();
+    // The info panel doesn't depend on the video, so fastfetch runs beside asset preparation
+    if (!g_args.render_only) g_info_panel.start(std::filesystem::current_path() / ".cache" / "fastfetch.txt", g_args.info_ttl, g_args.info_refresh);
+    const bool served = g_args.connect && request_from_daemon(argc, argv);
+    if (!served && (g_args.force_render || !load_manifest())) prepare_animation_assets();
+    render_pyramid_levels();
+    if (g_args.render_only) {
+        print_verbose("Render only: " + std::to_string(g_args.num_frames) + " frames in " + g_frame_pack_path.string());
+        return 0;
+    }
 
     if (g_args.actual_chafa_height <= 0) {
         print_verbose("Warning: actual_chafa_height is still invalid (" + std::to_string(g_args.actual_chafa_height) + ") after asset preparation. Using height_arg as fallback.");
@@ -1193,7 +6218,7 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    generate_static_template();
+    if (g_info_panel.unavailable()) std::cerr << "Warning: Could not run fastfetch or it produced no output. Static info will be minimal.\n";
     run_animation_loop();
 
     return 0;
@@ -0,0 +1,331 @@
+// Deterministic stand-ins for ffmpeg, ffprobe, chafa and fastfetch used by `make bench`.
+// One binary, dispatched on argv[0] (bench/bin/<tool> are symlinks to it). Output sizes are fixed
+// and every tool sleeps for a configurable latency, so a run measures anifetch's own orchestration
+// rather than the real tools.
+//
+// Environment:
+//   BENCH_VIDEO_DURATION      Seconds of video to pretend the input holds (default 10)
+//   BENCH_VIDEO_SIZE          Source frame size WxH (default 320x180)
+//   BENCH_DECODE_LATENCY_MS   ffmpeg cost per decoded frame (default 2)
+//   BENCH_CONVERT_LATENCY_MS  chafa cost per converted image (default 5)
+//   BENCH_GOP_SECONDS         Keyframe interval of the pretend 25 fps source (default 2, 0 for no packet index)
+//   BENCH_LOG                 If set, each invocation appends "<tool> <kind> <start_ns> <end_ns> <frames>"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+double env_double(const char* name, double fallback) {
+    const char* value = std::getenv(name);
+    return (value && *value) ? std::atof(value) : fallback;
+}
+
+void video_size(int& width, int& height) {
+    const char* value = std::getenv("BENCH_VIDEO_SIZE");
+    if (!value || std::sscanf(value, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        width = 320;
+        height = 180;
+    }
+}
+
+int64_t now_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void sleep_ms(double ms) {
+    if (ms > 0) std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(ms));
+}
+
+// One O_APPEND write per line keeps concurrent invocations from interleaving
+void log_invocation(const char* tool, const char* kind, int64_t start, int64_t end, long frames) {
+    const char* path = std::getenv("BENCH_LOG");
+    if (!path || !*path) return;
+    char line[160];
+    int len = std::snprintf(line, sizeof(line), "%s %s %lld %lld %ld\n", tool, kind,
+                            static_cast<long long>(start), static_cast<long long>(end), frames);
+    int fd = open(path, O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) return;
+    ssize_t ignored = write(fd, line, static_cast<size_t>(len));
+    (void)ignored;
+    close(fd);
+}
+
+std::string arg_value(const std::vector<std::string>& args, const std::string& key, const std::string& fallback = "") {
+    for (size_t i = 0; i + 1 < args.size(); ++i) {
+        if (args[i] == key) return args[i + 1];
+    }
+    return fallback;
+}
+
+bool has_arg(const std::vector<std::string>& args, const std::string& key) {
+    for (const auto& a : args) {
+        if (a == key) return true;
+    }
+    return false;
+}
+
+// A bright box sweeping across a gradient: cheap to make, different every frame
+void make_frame(long n, int width, int height, int channels, std::vector<unsigned char>& out) {
+    out.resize(static_cast<size_t>(width) * height * channels);
+    const int box_x = static_cast<int>((n * 7) % width);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            unsigned char v = (std::abs(x - box_x) < width / 8 && std::abs(y - height / 2) < height / 4)
+                                  ? 255 : static_cast<unsigned char>((x * 255 / std::max(1, width - 1)) / 4);
+            unsigned char* px = &out[(static_cast<size_t>(y) * width + x) * channels];
+            px[0] = v;
+            px[1] = v;
+            px[2] = static_cast<unsigned char>((n * 3) % 256);
+            if (channels == 4) px[3] = 255;
+        }
+    }
+}
+
+uint32_t crc32_update(uint32_t crc, const unsigned char* data, size_t len) {
+    crc = ~crc;
+    for (size_t i = 0; i < len; ++i) {
+        crc ^= data[i];
+        for (int k = 0; k < 8; ++k) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
+
+void put_be32(std::string& out, uint32_t v) {
+    out += static_cast<char>(v >> 24);
+    out += static_cast<char>(v >> 16);
+    out += static_cast<char>(v >> 8);
+    out += static_cast<char>(v);
+}
+
+void put_chunk(std::string& out, const char* type, const std::string& body) {
+    put_be32(out, static_cast<uint32_t>(body.size()));
+    std::string typed = std::string(type, 4) + body;
+    out += typed;
+    put_be32(out, crc32_update(0, reinterpret_cast<const unsigned char*>(typed.data()), typed.size()));
+}
+
+// Valid PNG with stored (uncompressed) deflate blocks
+std::string encode_png(const std::vector<unsigned char>& pixels, int width, int height, int channels) {
+    std::string raw;
+    const size_t stride = static_cast<size_t>(width) * channels;
+    for (int y = 0; y < height; ++y) {
+        raw += '\0';
+        raw.append(reinterpret_cast<const char*>(&pixels[y * stride]), stride);
+    }
+    std::string zdata = "\x78\x01";
+    for (size_t pos = 0; pos < raw.size() || pos == 0;) {
+        size_t block = std::min<size_t>(65535, raw.size() - pos);
+        bool last = pos + block >= raw.size();
+        zdata += static_cast<char>(last ? 1 : 0);
+        zdata += static_cast<char>(block & 0xFF);
+        zdata += static_cast<char>(block >> 8);
+        zdata += static_cast<char>(~block & 0xFF);
+        zdata += static_cast<char>((~block >> 8) & 0xFF);
+        zdata.append(raw, pos, block);
+        pos += block;
+        if (last) break;
+    }
+    uint32_t a = 1, b = 0;
+    for (unsigned char c : raw) {
+        a = (a + c) % 65521;
+        b = (b + a) % 65521;
+    }
+    put_be32(zdata, (b << 16) | a);
+
+    std::string png = "\x89PNG\r\n\x1a\n";
+    std::string ihdr;
+    put_be32(ihdr, static_cast<uint32_t>(width));
+    put_be32(ihdr, static_cast<uint32_t>(height));
+    ihdr += static_cast<char>(8);
+    ihdr += static_cast<char>(channels == 4 ? 6 : 2);
+    ihdr += std::string(3, '\0');
+    put_chunk(png, "IHDR", ihdr);
+    put_chunk(png, "IDAT", zdata);
+    put_chunk(png, "IEND", "");
+    return png;
+}
+
+int run_ffmpeg(const std::vector<std::string>& args) {
+    const int64_t start = now_ns();
+    const std::string output = args.empty() ? "" : args.back();
+    if (has_arg(args, "-vn")) { // Audio extraction
+        std::ofstream(output, std::ios::binary) << "audio";
+        log_invocation("ffmpeg", "audio", start, now_ns(), 0);
+        return 0;
+    }
+
+    const std::string filter = arg_value(args, "-vf");
+    int fps = 10;
+    size_t fps_pos = filter.find("fps=");
+    if (fps_pos != std::string::npos) fps = std::max(1, std::atoi(filter.c_str() + fps_pos + 4));
+    int width = 0, height = 0;
+    video_size(width, height);
+    size_t scale_pos = filter.find("scale=");
+    if (scale_pos != std::string::npos) std::sscanf(filter.c_str() + scale_pos + 6, "%d:%d", &width, &height);
+    const bool rgba = filter.find("rgba") != std::string::npos || arg_value(args, "-pix_fmt") == "rgba";
+    const int channels = rgba ? 4 : 3;
+
+    const double duration = env_double("BENCH_VIDEO_DURATION", 10.0);
+    const double seek = std::atof(arg_value(args, "-ss", "0").c_str());
+    const double length = std::atof(arg_value(args, "-t", std::to_string(duration)).c_str());
+    long first = std::lround(seek * fps);
+    long count = std::max(0L, std::lround(std::min(length, duration - seek) * fps));
+    std::string frame_limit = arg_value(args, "-vframes", arg_value(args, "-frames:v"));
+    if (!frame_limit.empty()) count = std::min(count, std::atol(frame_limit.c_str()));
+
+    const double latency = env_double("BENCH_DECODE_LATENCY_MS", 2.0);
+    const bool to_pipe = output == "pipe:1" || output == "-";
+    std::vector<unsigned char> pixels;
+    for (long i = 0; i < count; ++i) {
+        sleep_ms(latency);
+        make_frame(first + i, width, height, channels, pixels);
+        if (to_pipe) {
+            if (std::fwrite(pixels.data(), 1, pixels.size(), stdout) != pixels.size()) return 1; // Reader went away
+            continue;
+        }
+        char name[4096];
+        std::snprintf(name, sizeof(name), output.c_str(), static_cast<int>(i + 1));
+        std::ofstream png_out(name, std::ios::binary);
+        png_out << encode_png(pixels, width, height, channels);
+    }
+    std::fflush(stdout);
+    log_invocation("ffmpeg", has_arg(args, "-vframes") ? "probe-frame" : (to_pipe ? "raw" : "png"), start, now_ns(), count);
+    return 0;
+}
+
+int run_ffprobe(const std::vector<std::string>& args) {
+    std::string joined;
+    for (const auto& a : args) joined += a + " ";
+    if (joined.find("format=duration") != std::string::npos) {
+        std::printf("%f\n", env_double("BENCH_VIDEO_DURATION", 10.0));
+    } else if (joined.find("width,height") != std::string::npos) {
+        int width = 0, height = 0;
+        video_size(width, height);
+        std::printf("%dx%d\n", width, height);
+    } else if (joined.find("codec_name") != std::string::npos) {
+        // No audio stream
+    } else if (joined.find("packet=pts_time,flags") != std::string::npos) {
+        const double gop = env_double("BENCH_GOP_SECONDS", 2.0);
+        const long packets = std::lround(env_double("BENCH_VIDEO_DURATION", 10.0) * 25);
+        const long keyframe_every = std::max(1L, std::lround(gop * 25));
+        for (long i = 0; gop > 0 && i < packets; ++i) std::printf("%.6f,%s\n", i / 25.0, i % keyframe_every == 0 ? "K__" : "___");
+    } else {
+        return 1;
+    }
+    return 0;
+}
+
+uint32_t get_be32(const std::string& data, size_t pos) {
+    return (static_cast<uint32_t>(static_cast<unsigned char>(data[pos])) << 24) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 1])) << 16) |
+           (static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 2])) << 8) |
+           static_cast<uint32_t>(static_cast<unsigned char>(data[pos + 3]));
+}
+
+// Scanlines of a PNG made of stored deflate blocks (what encode_png and anifetch both write), so the
+// same pixels convert to the same text whichever side encoded them. Anything else is returned as is.
+std::string png_scanlines(const std::string& data) {
+    if (data.size() < 8 || data.compare(0, 8, "\x89PNG\r\n\x1a\n") != 0) return data;
+    std::string zdata;
+    for (size_t pos = 8; pos + 12 <= data.size();) {
+        const size_t len = get_be32(data, pos);
+        if (len > data.size() - pos - 12) return data;
+        if (data.compare(pos + 4, 4, "IDAT") == 0) zdata.append(data, pos + 8, len);
+        pos += 12 + len;
+    }
+    std::string raw;
+    for (size_t pos = 2; pos + 5 <= zdata.size();) {
+        const bool last = zdata[pos] & 1;
+        const size_t len = static_cast<unsigned char>(zdata[pos + 1]) | (static_cast<size_t>(static_cast<unsigned char>(zdata[pos + 2])) << 8);
+        if ((zdata[pos] & 6) != 0 || len > zdata.size() - pos - 5) return data; // Not a stored block
+        raw.append(zdata, pos + 5, len);
+        pos += 5 + len;
+        if (last) break;
+    }
+    return raw;
+}
+
+int run_chafa(const std::vector<std::string>& args) {
+    int width = 40, height = 20;
+    std::vector<std::string> inputs;
+    for (size_t i = 0; i < args.size(); ++i) {
+        const std::string& a = args[i];
+        if (a.rfind("--size=", 0) == 0) {
+            std::sscanf(a.c_str() + 7, "%dx%d", &width, &height);
+        } else if (a == "-") {
+            inputs.push_back(a);
+        } else if (a.rfind("-", 0) == 0) {
+            if (a.find('=') == std::string::npos && i + 1 < args.size() && args[i + 1].rfind("-", 0) != 0 &&
+                args[i + 1].find('/') == std::string::npos && args[i + 1].find('.') == std::string::npos) {
+                ++i; // Option value, e.g. "--symbols ascii"
+            }
+        } else {
+            inputs.push_back(a);
+        }
+    }
+
+    const double latency = env_double("BENCH_CONVERT_LATENCY_MS", 5.0);
+    static const char kRamp[] = " .:-=+*#%@";
+    const int64_t start = now_ns();
+    for (const auto& input : inputs) {
+        sleep_ms(latency);
+        std::string data;
+        if (input == "-") {
+            char chunk[65536];
+            for (size_t got; (got = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0;) data.append(chunk, got);
+        } else {
+            std::ifstream in(input, std::ios::binary);
+            data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        }
+        data = png_scanlines(data);
+        unsigned seed = 0;
+        for (size_t i = data.size() > 256 ? data.size() - 256 : 0; i < data.size(); ++i) seed = seed * 31 + static_cast<unsigned char>(data[i]);
+        std::string text;
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) text += kRamp[(x + y + seed) % 10];
+            text += '\n';
+        }
+        std::fwrite(text.data(), 1, text.size(), stdout);
+    }
+    std::fflush(stdout);
+    log_invocation("chafa", "convert", start, now_ns(), static_cast<long>(inputs.size()));
+    return 0;
+}
+
+int run_fastfetch() {
+    static const char* kLines[] = {
+        "bench@anifetch", "--------------", "OS: Bench Linux", "Kernel: 6.0.0-bench", "Uptime: 1 hour",
+        "Shell: sh", "Terminal: bench", "CPU: Stub CPU", "Memory: 1.00 GiB / 2.00 GiB",
+    };
+    for (const char* line : kLines) std::printf("%s\n", line);
+    return 0;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string tool = argv[0];
+    size_t slash = tool.rfind('/');
+    if (slash != std::string::npos) tool = tool.substr(slash + 1);
+    std::vector<std::string> args(argv + 1, argv + argc);
+
+    if (tool == "ffmpeg") return run_ffmpeg(args);
+    if (tool == "ffprobe") return run_ffprobe(args);
+    if (tool == "chafa") return run_chafa(args);
+    if (tool == "fastfetch") return run_fastfetch();
+    std::fprintf(stderr, "stub_tools: unknown tool name '%s'\n", tool.c_str());
+    return 2;
+}